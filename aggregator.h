@@ -0,0 +1,211 @@
+/**
+ *  Aggregator.h
+ *
+ *  When an algorithm has a nativeAggregator() method that returns one of the
+ *  built-in reducers, the key/value pairs that are emitted by the mapper are
+ *  not written to the shuffle files one by one. Instead, a partial result
+ *  is kept in a hash table for each key, and the partial results are emitted
+ *  when the table gets too big (see the yothalot.maxaggregate setting), or
+ *  when the mapper is ready.
+ *
+ *  @copyright 2016 Copernica BV
+ */
+
+/**
+ *  Include guard
+ */
+#pragma once
+
+/**
+ *  Dependencies
+ */
+#include <yothalot.h>
+#include <unordered_map>
+#include <memory>
+#include <string>
+#include "tuple.h"
+#include "reduce/base.h"
+
+/**
+ *  Class definition
+ */
+class Aggregator : public Yothalot::Reducer
+{
+private:
+    /**
+     *  A key with the partial result
+     */
+    class Entry
+    {
+    public:
+        /**
+         *  The key
+         *  @var std::unique_ptr<Tuple::Copy>
+         */
+        std::unique_ptr<Tuple::Copy> key;
+
+        /**
+         *  The partial result
+         *  @var std::unique_ptr<Reduce::Base::Partial>
+         */
+        std::unique_ptr<Reduce::Base::Partial> value;
+
+        /**
+         *  Constructor
+         *  @param  key
+         */
+        Entry(const Yothalot::Key &key) : key(new Tuple::Copy(key)) {}
+    };
+
+    /**
+     *  The built-in reducer that merges the values
+     *  @var Reduce::Base
+     */
+    Reduce::Base &_operation;
+
+    /**
+     *  The reducer to which the partial results are emitted
+     *  @var Yothalot::Reducer
+     */
+    Yothalot::Reducer *_reducer = nullptr;
+
+    /**
+     *  Should the partial results be finalized before they are emitted? This
+     *  is necessary when they are not reduced by the same built-in reducer,
+     *  because that reducer is the only one that understands them as they are
+     *  @var bool
+     */
+    bool _finalize;
+
+    /**
+     *  The partial results, indexed by the serialized key
+     *  @var std::unordered_map
+     */
+    std::unordered_map<std::string,Entry> _entries;
+
+    /**
+     *  Max number of bytes to be kept in the table
+     *  @var size_t
+     */
+    size_t _maxbytes;
+
+    /**
+     *  Estimated number of bytes in the table
+     *  @var size_t
+     */
+    size_t _bytes = 0;
+
+
+public:
+    /**
+     *  Constructor
+     *  @param  operation   The built-in reducer that merges the values
+     *  @param  maxbytes    Max number of bytes to be kept in the table
+     *  @param  finalize    Should the partial results be finalized before they are emitted?
+     */
+    Aggregator(Reduce::Base &operation, size_t maxbytes, bool finalize) : _operation(operation), _finalize(finalize), _maxbytes(maxbytes) {}
+
+    /**
+     *  No copying
+     *  @param  that
+     */
+    Aggregator(const Aggregator &that) = delete;
+
+    /**
+     *  Destructor
+     */
+    virtual ~Aggregator() = default;
+
+    /**
+     *  Set the reducer to which the partial results are emitted
+     *  @param  reducer
+     *  @return Aggregator
+     */
+    Aggregator &target(Yothalot::Reducer &reducer)
+    {
+        // when the target changes, the partial results belong to the old target
+        if (_reducer != &reducer) flush();
+
+        // store the new target
+        _reducer = &reducer;
+
+        // allow chaining
+        return *this;
+    }
+
+    /**
+     *  Emit a key/value pair, this is called by the mapper
+     *  @param  key
+     *  @param  value
+     */
+    virtual void emit(const Yothalot::Key &key, const Yothalot::Value &value) override
+    {
+        // serialize the key to look up the entry
+        Tuple::Index index(key);
+
+        // find the entry, or create a new one
+        auto iter = _entries.find(index);
+        if (iter == _entries.end())
+        {
+            // add the entry
+            iter = _entries.emplace(std::move(index), Entry(key)).first;
+
+            // keep track of the memory that is used by the key
+            _bytes += iter->first.size() + iter->second.key->bytes();
+        }
+
+        // the partial result that is going to be updated
+        auto &partial = iter->second.value;
+
+        // create it for the first value, otherwise its old size no longer counts
+        if (!partial) partial.reset(_operation.partial());
+        else _bytes -= partial->bytes();
+
+        // merge the value
+        partial->merge(value);
+
+        // keep track of the memory that is used by the updated partial result
+        _bytes += partial->bytes();
+
+        // when the table is too big, we emit what we have
+        if (_bytes > _maxbytes) flush();
+    }
+
+    /**
+     *  Emit all partial results to the reducer
+     */
+    void flush()
+    {
+        // emit all the partial results
+        for (auto &iter : _entries)
+        {
+            // the partial result
+            const Yothalot::Tuple &result = iter.second.value->result();
+
+            // it may have to be converted into a plain value first
+            Tuple::Copy buffer;
+
+            // emit the partial result with the key
+            _reducer->emit(*iter.second.key, _finalize ? _operation.finalize(result, buffer) : result);
+        }
+
+        // the table is empty
+        _entries.clear();
+        _bytes = 0;
+    }
+
+    /**
+     *  Forget the partial results and the reducer, this is used when the
+     *  mapper failed, and the reducer is about to be destructed
+     */
+    void reset()
+    {
+        // the table is empty
+        _entries.clear();
+        _bytes = 0;
+
+        // the reducer is no longer valid
+        _reducer = nullptr;
+    }
+};
+
@@ -0,0 +1,112 @@
+/**
+ *  Envelope.cpp
+ *
+ *  Benchmark for the job envelope. A job with a number of inline input
+ *  entries is encoded and decoded a number of times, both as JSON text and
+ *  as MessagePack, and the size of the message and the time per round are
+ *  reported, for 10, 1000 and 100000 entries.
+ *
+ *  Build and run with "make bench"
+ *
+ *  @copyright 2016 Copernica BV
+ */
+
+/**
+ *  Dependencies
+ */
+#include <chrono>
+#include <iostream>
+#include <string>
+#include "../json/msgpack.h"
+
+/**
+ *  Build a job with inline input entries, similar to the data that is
+ *  added with Yothalot\Job::add()
+ *  @param  count       number of entries
+ *  @return json_object
+ */
+static json_object *job(size_t count)
+{
+    // the job, and its input
+    auto *job = json_object_new_object();
+    auto *input = json_object_new_array();
+
+    // add the entries
+    for (size_t i = 0; i < count; ++i)
+    {
+        // an entry with data, and one with a filename
+        auto *entry = json_object_new_object();
+        std::string data = "key " + std::to_string(i) + "\tsome value for the mapper " + std::to_string(i * 7);
+        json_object_object_add(entry, "data", json_object_new_string_len(data.data(), data.size()));
+        json_object_object_add(entry, "start", json_object_new_int64(i * 1024));
+        json_object_object_add(entry, "size", json_object_new_int64(1024));
+        json_object_object_add(entry, "remove", json_object_new_boolean(i % 2));
+        json_object_array_add(input, entry);
+    }
+
+    // the other properties of a job
+    json_object_object_add(job, "processes", json_object_new_int(20));
+    json_object_object_add(job, "modulo", json_object_new_int(1));
+    json_object_object_add(job, "input", input);
+
+    // done
+    return job;
+}
+
+/**
+ *  Run the benchmark for a number of entries
+ *  @param  count       number of entries
+ *  @param  rounds      number of times that the job is encoded and decoded
+ */
+static void run(size_t count, size_t rounds)
+{
+    // the job
+    auto *internal = job(count);
+    JSON::Object object(internal);
+    json_object_put(internal);
+
+    // the encoded messages
+    std::string text = object.toString();
+    std::string binary = JSON::MsgPack::encode(object);
+
+    // the messages must hold the same data
+    if (JSON::MsgPack::decode(binary.data(), binary.size()).toString() != text) { std::cerr << "msgpack round trip failed" << std::endl; return; }
+
+    // start the clock
+    auto start = std::chrono::steady_clock::now();
+
+    // encode and decode as json
+    for (size_t r = 0; r < rounds; ++r) JSON::Object(object.toString());
+
+    // the time for json
+    std::chrono::duration<double> json = std::chrono::steady_clock::now() - start;
+
+    // restart the clock
+    start = std::chrono::steady_clock::now();
+
+    // encode and decode as msgpack
+    for (size_t r = 0; r < rounds; ++r) { auto encoded = JSON::MsgPack::encode(object); JSON::MsgPack::decode(encoded.data(), encoded.size()); }
+
+    // the time for msgpack
+    std::chrono::duration<double> msgpack = std::chrono::steady_clock::now() - start;
+
+    // report
+    std::cout << count << " entries: json " << text.size() << " bytes, " << (json.count() / rounds * 1000000) << " us/round, "
+              << "msgpack " << binary.size() << " bytes, " << (msgpack.count() / rounds * 1000000) << " us/round" << std::endl;
+}
+
+/**
+ *  Main procedure
+ *  @return int
+ */
+int main()
+{
+    // run with an increasing number of entries
+    run(10, 100000);
+    run(1000, 1000);
+    run(100000, 10);
+
+    // done
+    return 0;
+}
+
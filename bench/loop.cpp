@@ -0,0 +1,111 @@
+/**
+ *  Loop.cpp
+ *
+ *  Benchmark for the event loop. A number of pipes is registered with the
+ *  loop, a byte is written into each of them, and the loop runs until all
+ *  bytes are read again. This is repeated a number of times, and the number
+ *  of events that are dispatched per second is reported, for 10, 1000 and
+ *  10000 filedescriptors.
+ *
+ *  Build and run with "make bench"
+ *
+ *  @copyright 2016 Copernica BV
+ */
+
+/**
+ *  Dependencies
+ */
+#include <amqpcpp.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <chrono>
+#include <iostream>
+#include <vector>
+#include "../loop.h"
+
+/**
+ *  Run the benchmark for a number of filedescriptors
+ *  @param  count       number of pipes
+ *  @param  rounds      number of times that all pipes are made readable
+ */
+static void run(size_t count, size_t rounds)
+{
+    // the pipes, and the descriptors that are watched
+    std::vector<int> readers, writers;
+    Descriptors descriptors;
+
+    // function to close all pipes that were created
+    auto cleanup = [&readers, &writers, &descriptors]() {
+        for (size_t i = 0; i < readers.size(); ++i) { descriptors.remove(readers[i]); close(readers[i]); close(writers[i]); }
+    };
+
+    // create all the pipes
+    for (size_t i = 0; i < count; ++i)
+    {
+        // create the pipe
+        int fds[2];
+        if (pipe(fds) != 0) { std::cerr << "pipe: " << strerror(errno) << std::endl; return cleanup(); }
+
+        // remember the ends, and watch the read end
+        readers.push_back(fds[0]);
+        writers.push_back(fds[1]);
+        descriptors.add(fds[0], AMQP::readable);
+    }
+
+    // the event loop
+    Loop loop(descriptors);
+
+    // number of events that were dispatched
+    size_t events = 0;
+
+    // callback that reads the byte from the pipe
+    auto callback = [&events](int fd, int) {
+        char byte;
+        if (read(fd, &byte, 1) == 1) ++events;
+    };
+
+    // start the clock
+    auto start = std::chrono::steady_clock::now();
+
+    // run all the rounds
+    for (size_t r = 0; r < rounds; ++r)
+    {
+        // make all pipes readable
+        for (auto fd : writers) if (write(fd, "x", 1) != 1) { std::cerr << "write: " << strerror(errno) << std::endl; return cleanup(); }
+
+        // run the loop until all bytes were read
+        while (events < (r + 1) * count) loop.step(callback);
+    }
+
+    // stop the clock
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    // report the rate
+    std::cout << count << " descriptors: " << (size_t)(events / elapsed.count()) << " events/sec" << std::endl;
+
+    // close all pipes
+    cleanup();
+}
+
+/**
+ *  Main procedure
+ *  @return int
+ */
+int main()
+{
+    // we need two filedescriptors per pipe
+    struct rlimit limit;
+    getrlimit(RLIMIT_NOFILE, &limit);
+    limit.rlim_cur = std::max(limit.rlim_cur, std::min(limit.rlim_max, (rlim_t)25000));
+    setrlimit(RLIMIT_NOFILE, &limit);
+
+    // run with an increasing number of descriptors, but the same number of events
+    run(10, 100000);
+    run(1000, 1000);
+    run(10000, 100);
+
+    // done
+    return 0;
+}
@@ -0,0 +1,328 @@
+/**
+ *  Blobs.h
+ *
+ *  Serialized algorithms that are stored in the cache, so that they do not
+ *  have to be sent with every job. The process that starts jobs remembers
+ *  which algorithms it already stored (and reuses them for as long as they
+ *  do not expire), and worker processes keep a copy of the algorithms that
+ *  they loaded in the temp directory, so that each algorithm is fetched from
+ *  the cache only once per machine. Only the most recently used copies are
+ *  kept.
+ *
+ *  Every job also writes the algorithm to a file on the distributed file
+ *  system, which the workers use when the object is no longer in the cache.
+ *
+ *  @copyright 2016 Copernica BV
+ */
+
+/**
+ *  Include guard
+ */
+#pragma once
+
+/**
+ *  Dependencies
+ */
+#include <yothalot.h>
+#include <functional>
+#include <fstream>
+#include <sstream>
+#include <iterator>
+#include <string>
+#include <map>
+#include <stdexcept>
+#include <time.h>
+#include <stdio.h>
+#include <unistd.h>
+#include "tempdir.h"
+#include "tempfiles.h"
+#include "base.h"
+
+/**
+ *  Class definition
+ */
+class Blobs
+{
+private:
+    /**
+     *  Max number of algorithms that are remembered
+     *  @var size_t
+     */
+    static const size_t maxsize = 16;
+
+    /**
+     *  Max number of local copies that a worker machine keeps
+     *  @var size_t
+     */
+    static const size_t maxcopies = 64;
+
+    /**
+     *  An algorithm that was stored
+     */
+    class Entry
+    {
+    public:
+        /**
+         *  The serialized algorithm
+         *  @var std::string
+         */
+        std::string data;
+
+        /**
+         *  Name of the stored object
+         *  @var std::string
+         */
+        std::string name;
+
+        /**
+         *  Moment until which the stored object can be reused
+         *  @var time_t
+         */
+        time_t expires;
+
+        /**
+         *  Constructor
+         *  @param  data
+         *  @param  name
+         *  @param  expires
+         */
+        Entry(const std::string &data, const std::string &name, time_t expires) :
+            data(data), name(name), expires(expires) {}
+    };
+
+    /**
+     *  The stored algorithms, indexed by the hash of the serialized data
+     *  @var std::multimap
+     */
+    std::multimap<size_t,Entry> _entries;
+
+    /**
+     *  Constructor
+     */
+    Blobs() = default;
+
+    /**
+     *  Name of the file in which a worker keeps a copy of a stored algorithm
+     *  @param  name        name of the stored object
+     *  @return std::string
+     */
+    static std::string filename(const std::string &name)
+    {
+        // the names are unique, so the hash of the name identifies the algorithm
+        std::ostringstream stream;
+        stream << (const char *)TempDir() << "/yothalot-blob-" << std::hex << std::hash<std::string>()(name);
+
+        // expose the filename
+        return stream.str();
+    }
+
+    /**
+     *  Read the local copy of a stored algorithm
+     *  @param  name        name of the stored object
+     *  @param  data        the data that is read
+     *  @return bool
+     */
+    static bool read(const std::string &name, std::string &data)
+    {
+        // open the file
+        std::ifstream file(filename(name), std::ios::binary);
+
+        // the first line holds the name of the object, to detect hash collisions
+        std::string line;
+        if (!std::getline(file, line) || line != name) return false;
+
+        // the rest is the data
+        data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+
+        // leap out on failure
+        if (file.bad()) return false;
+
+        // the copy was used, so it should not be removed soon
+        TempFiles::touch(filename(name));
+
+        // done
+        return true;
+    }
+
+    /**
+     *  Read an algorithm from a stored object or file
+     *  @param  name        name of the object or file
+     *  @param  data        the data that is read
+     *  @return bool
+     */
+    static bool fetch(const char *name, std::string &data)
+    {
+        // the object may no longer exist
+        try
+        {
+            // open the object
+            Yothalot::Input input(name);
+
+            // it should still be there
+            if (!input.valid()) return false;
+
+            // the data is stored as the only field of the first record
+            Yothalot::Record record(input);
+            data = record.string(0);
+
+            // done
+            return true;
+        }
+        catch (const std::exception &)
+        {
+            // the object could not be read
+            return false;
+        }
+    }
+
+    /**
+     *  Keep a local copy of a stored algorithm
+     *  @param  name        name of the stored object
+     *  @param  data        the data
+     */
+    static void write(const std::string &name, const std::string &data)
+    {
+        // the file to write to, and a temporary file so that other processes
+        // never see a half-written file
+        auto target = filename(name);
+        auto temp = target + "." + std::to_string(getpid());
+
+        // write the temporary file
+        {
+            std::ofstream file(temp, std::ios::binary | std::ios::trunc);
+            file << name << '\n' << data;
+            if (!file.good()) { unlink(temp.data()); return; }
+        }
+
+        // move it into place
+        if (rename(temp.data(), target.data()) != 0) unlink(temp.data());
+
+        // we do not want the copies to pile up
+        TempFiles::prune("yothalot-blob-", maxcopies);
+    }
+
+public:
+    /**
+     *  No copying
+     *  @param  that
+     */
+    Blobs(const Blobs &that) = delete;
+
+    /**
+     *  Destructor
+     */
+    virtual ~Blobs() = default;
+
+    /**
+     *  The algorithms that were stored by this process
+     *  @return Blobs
+     */
+    static Blobs &instance()
+    {
+        // the one and only instance
+        static Blobs blobs;
+
+        // expose it
+        return blobs;
+    }
+
+    /**
+     *  Find the stored object for an algorithm
+     *  @param  data        the serialized algorithm
+     *  @return const char* name of the stored object, or nullptr if it is not stored (anymore)
+     */
+    const char *find(const std::string &data) const
+    {
+        // look for an entry with the same data
+        auto range = _entries.equal_range(std::hash<std::string>()(data));
+        for (auto iter = range.first; iter != range.second; ++iter)
+        {
+            // the data must be identical, and the object still available
+            if (iter->second.data == data && iter->second.expires > time(nullptr)) return iter->second.name.data();
+        }
+
+        // not found
+        return nullptr;
+    }
+
+    /**
+     *  Remember that an algorithm was stored
+     *  @param  data        the serialized algorithm
+     *  @param  name        name of the stored object
+     *  @param  ttl         time-to-live of the stored object
+     */
+    void add(const std::string &data, const std::string &name, time_t ttl)
+    {
+        // we do not want this to grow forever
+        if (_entries.size() >= maxsize) _entries.clear();
+
+        // the object is only reused during the first half of its lifetime,
+        // so that the jobs that use it still have time to load it
+        _entries.emplace(std::hash<std::string>()(data), Entry(data, name, time(nullptr) + ttl / 2));
+    }
+
+    /**
+     *  Store the algorithm in a file on the distributed file system, that is
+     *  used when the stored object is no longer in the cache
+     *  @param  data        the serialized algorithm
+     *  @return std::string name of the file, relative to the base directory
+     *  @throws std::runtime_error
+     */
+    static std::string fallback(const std::string &data)
+    {
+        // the name of the file
+        std::string name = std::string("tmp/") + (std::string)Yothalot::UniqueName();
+
+        // the record with the algorithm
+        Yothalot::Record record(0);
+        record.add(data);
+
+        // write the file
+        Yothalot::Output output(Yothalot::Fullname(base(), name).full());
+        output.add(record);
+        output.flush();
+
+        // done
+        return name;
+    }
+
+    /**
+     *  Remove the file that was created with fallback()
+     *  @param  name        name of the file, relative to the base directory
+     */
+    static void discard(const std::string &name)
+    {
+        // remove the file
+        unlink(Yothalot::Fullname(base(), name).full());
+    }
+
+    /**
+     *  Load a stored algorithm, from the local copy, from the cache, or from
+     *  the file on the distributed file system
+     *  @param  name        name of the stored object
+     *  @param  fallback    name of the file, relative to the base directory (may be empty)
+     *  @return std::string
+     *  @throws std::runtime_error
+     */
+    static std::string load(const std::string &name, const std::string &fallback)
+    {
+        // the result
+        std::string data;
+
+        // check the local copy first
+        if (read(name, data)) return data;
+
+        // load the object from the cache, or when it was evicted from the file
+        bool loaded = fetch(name.data(), data) || (!fallback.empty() && fetch(Yothalot::Fullname(base(), fallback).full(), data));
+
+        // one of them should still be there
+        if (!loaded) throw std::runtime_error("failed to load algorithm from " + name);
+
+        // keep a copy for the next process on this machine
+        write(name, data);
+
+        // done
+        return data;
+    }
+};
+
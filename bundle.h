@@ -0,0 +1,325 @@
+/**
+ *  Bundle.h
+ *
+ *  When the "yothalot.bundle" setting is enabled, the files that are returned
+ *  by the includes() method of an algorithm are not read by the workers from
+ *  the distributed file system. Instead, their contents are packed into the
+ *  serialized job data (which is stored in the cache when it is big), and
+ *  the workers unpack them once per machine into a local directory that is
+ *  named after the hash of the contents, and include them from there.
+ *
+ *  The files are unpacked under their original absolute path inside that
+ *  directory (relative paths are resolved on the client, just like PHP would
+ *  resolve them), so that files that include each other relative to __DIR__
+ *  keep working, as long as all of them are returned by includes(). Only the
+ *  most recently used directories are kept.
+ *
+ *  @copyright 2016 Copernica BV
+ */
+
+/**
+ *  Include guard
+ */
+#pragma once
+
+/**
+ *  Dependencies
+ */
+#include <phpcpp.h>
+#include <functional>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <map>
+#include <stdexcept>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdlib.h>
+#include "tempdir.h"
+#include "tempfiles.h"
+
+/**
+ *  Class definition
+ */
+class Bundle
+{
+private:
+    /**
+     *  Max number of unpacked bundles that a worker machine keeps
+     *  @var size_t
+     */
+    static const size_t maxcopies = 16;
+
+    /**
+     *  A file that was read by this process
+     */
+    class File
+    {
+    public:
+        /**
+         *  Modification time and size when the file was read
+         *  @var time_t
+         *  @var off_t
+         */
+        time_t mtime = 0;
+        off_t size = -1;
+
+        /**
+         *  The contents
+         *  @var std::string
+         */
+        std::string contents;
+    };
+
+    /**
+     *  Read a file, files that did not change since they were read by an
+     *  earlier job are not read again
+     *  @param  path
+     *  @return std::string
+     *  @throws std::runtime_error
+     */
+    static const std::string &read(const std::string &path)
+    {
+        // the files that were read by this process
+        static std::map<std::string,File> files;
+
+        // find out when the file was modified
+        struct stat info;
+        if (stat(path.data(), &info) != 0) throw std::runtime_error("failed to bundle " + path);
+
+        // the file that we read before
+        auto &file = files[path];
+
+        // we can use the contents if the file did not change
+        if (file.mtime == info.st_mtime && file.size == info.st_size) return file.contents;
+
+        // open the file
+        std::ifstream stream(path, std::ios::binary);
+        if (!stream) throw std::runtime_error("failed to bundle " + path);
+
+        // read it
+        file.contents.assign(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+        file.mtime = info.st_mtime;
+        file.size = info.st_size;
+
+        // done
+        return file.contents;
+    }
+
+    /**
+     *  Turn the path of an include file into a canonical absolute path, the
+     *  same file that PHP would include (relative to the include path)
+     *  @param  path
+     *  @return std::string
+     *  @throws std::runtime_error
+     */
+    static std::string resolve(const std::string &path)
+    {
+        // let php find the file, just like include_once() does
+        Php::Value found = Php::call("stream_resolve_include_path", path);
+
+        // the file must exist
+        if (!found.isString()) throw std::runtime_error("failed to bundle " + path);
+
+        // the canonical path
+        char buffer[PATH_MAX];
+        if (realpath(found.rawValue(), buffer) == nullptr) throw std::runtime_error("failed to bundle " + path);
+
+        // done
+        return buffer;
+    }
+
+    /**
+     *  Is a path safe to unpack, it should be absolute, and it should not
+     *  have any ".." components
+     *  @param  path
+     *  @return bool
+     */
+    static bool safe(const std::string &path)
+    {
+        // must be absolute
+        if (path.empty() || path[0] != '/') return false;
+
+        // check all components
+        for (size_t start = 1; start <= path.size(); )
+        {
+            // find the end of the component
+            size_t end = path.find('/', start);
+            if (end == std::string::npos) end = path.size();
+
+            // parent directories are not allowed
+            if (path.compare(start, end - start, "..") == 0) return false;
+
+            // next component
+            start = end + 1;
+        }
+
+        // the path is fine
+        return true;
+    }
+
+    /**
+     *  Create a directory and all its parents
+     *  @param  path
+     *  @return bool
+     */
+    static bool mkdirs(const std::string &path)
+    {
+        // create all the parents first
+        for (size_t pos = path.find('/', 1); pos != std::string::npos; pos = path.find('/', pos + 1))
+        {
+            // create the parent (it may already exist)
+            if (mkdir(path.substr(0, pos).data(), 0700) != 0 && errno != EEXIST) return false;
+        }
+
+        // create the directory itself
+        return mkdir(path.data(), 0700) == 0 || errno == EEXIST;
+    }
+
+    /**
+     *  Write a file, other processes never see a half-written file
+     *  @param  path
+     *  @param  contents
+     *  @throws std::runtime_error
+     */
+    static void write(const std::string &path, const std::string &contents)
+    {
+        // create the directory
+        if (!mkdirs(path.substr(0, path.rfind('/')))) throw std::runtime_error("failed to create directory for " + path);
+
+        // the temporary file
+        auto temp = path + "." + std::to_string(getpid());
+
+        // write the temporary file
+        {
+            std::ofstream file(temp, std::ios::binary | std::ios::trunc);
+            file << contents;
+            if (!file.good()) { unlink(temp.data()); throw std::runtime_error("failed to write " + path); }
+        }
+
+        // move it into place
+        if (rename(temp.data(), path.data()) != 0) { unlink(temp.data()); throw std::runtime_error("failed to write " + path); }
+    }
+
+public:
+    /**
+     *  Is bundling enabled?
+     *  @return bool
+     */
+    static bool enabled()
+    {
+        return Php::ini_get("yothalot.bundle").boolValue();
+    }
+
+    /**
+     *  Pack the files that are returned by the includes() method
+     *  @param  includes    a single path, or an array of paths
+     *  @return Php::Value
+     *  @throws std::runtime_error
+     */
+    static Php::Value pack(const Php::Value &includes)
+    {
+        // the paths that should be bundled
+        Php::Value paths(Php::Type::Array);
+        if (includes.isString()) paths[0] = includes;
+        else if (includes.isArray()) paths = includes;
+
+        // the files in the bundle
+        Php::Value files(Php::Type::Array);
+
+        // the hash of all paths and contents
+        size_t hash = 0;
+
+        // add all files
+        for (int i = 0; i < paths.size(); ++i)
+        {
+            // the canonical path, and the contents of the file
+            std::string path = resolve(paths[i].stringValue());
+            auto &contents = read(path);
+
+            // add to the bundle
+            Php::Value file(Php::Type::Array);
+            file[0] = path;
+            file[1] = Php::Value(contents.data(), contents.size());
+            files[i] = file;
+
+            // update the hash
+            hash = hash * 31 + std::hash<std::string>()(path + '\0' + contents);
+        }
+
+        // the hash as hex string
+        std::ostringstream stream;
+        stream << std::hex << hash;
+
+        // create the bundle
+        Php::Value result(Php::Type::Array);
+        result["bundle"] = stream.str();
+        result["files"] = files;
+
+        // done
+        return result;
+    }
+
+    /**
+     *  Unpack a bundle into the local directory, if it was not unpacked yet
+     *  @param  bundle      the bundle
+     *  @return Php::Value  the local paths of the files
+     *  @throws std::runtime_error
+     */
+    static Php::Value unpack(const Php::Value &bundle)
+    {
+        // the hash of the bundle
+        std::string hash = bundle.get("bundle").stringValue();
+
+        // the hash is used in a path, so it must be a plain hex string
+        if (hash.empty() || hash.find_first_not_of("0123456789abcdef") != std::string::npos) throw std::runtime_error("invalid bundle");
+
+        // the directory to unpack to, and the file that marks a complete directory
+        std::string directory = std::string((const char *)TempDir()) + "/yothalot-bundle-" + hash;
+        std::string marker = directory + "/.complete";
+
+        // was it already unpacked?
+        bool unpacked = access(marker.data(), F_OK) == 0;
+
+        // the files in the bundle, and the local paths
+        Php::Value files = bundle.get("files");
+        Php::Value result(Php::Type::Array);
+
+        // process all files
+        for (int i = 0; i < files.size(); ++i)
+        {
+            // the file
+            Php::Value file = files[i];
+            std::string path = file[0].stringValue();
+
+            // files should not be written outside the directory
+            if (!safe(path)) throw std::runtime_error("invalid path in bundle: " + path);
+
+            // the local path
+            std::string local = directory + path;
+
+            // write the file if this was not done before
+            if (!unpacked) write(local, file[1].stringValue());
+
+            // add to the result
+            result[i] = local;
+        }
+
+        // mark the directory as complete
+        if (!unpacked) write(marker, "");
+
+        // the directory was used, so it should not be removed soon
+        TempFiles::touch(directory);
+
+        // we do not want the directories to pile up
+        if (!unpacked) TempFiles::prune("yothalot-bundle-", maxcopies);
+
+        // done
+        return result;
+    }
+};
+
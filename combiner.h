@@ -0,0 +1,275 @@
+/**
+ *  Combiner.h
+ *
+ *  When a Yothalot\MapReduce2 algorithm has a combine() method, the key/value
+ *  pairs that are emitted by the mapper do not immediately go to the shuffle
+ *  files. Instead, they are grouped by key in this object, and passed to the
+ *  combine() method of the algorithm when the buffer is full, or when the
+ *  mapper is ready. Only the values that are emitted by combine() end up in
+ *  the shuffle files.
+ *
+ *  @copyright 2016 Copernica BV
+ */
+
+/**
+ *  Include guard
+ */
+#pragma once
+
+/**
+ *  Dependencies
+ */
+#include <phpcpp.h>
+#include <yothalot.h>
+#include <unordered_map>
+#include <memory>
+#include <vector>
+#include <string>
+#include "tuple.h"
+#include "proxies.h"
+
+/**
+ *  Class definition
+ */
+class Combiner : public Yothalot::Reducer
+{
+private:
+    /**
+     *  A key with all the values that were emitted for it
+     */
+    class Group
+    {
+    public:
+        /**
+         *  The key
+         *  @var std::unique_ptr<Tuple::Copy>
+         */
+        std::unique_ptr<Tuple::Copy> key;
+
+        /**
+         *  The values
+         *  @var Values::Buffer
+         */
+        Values::Buffer values;
+
+        /**
+         *  Constructor
+         *  @param  key
+         */
+        Group(const Yothalot::Key &key) : key(new Tuple::Copy(key)) {}
+    };
+
+    /**
+     *  Writer that is passed to combine(), it collects the combined values,
+     *  they are only passed on when combine() did not fail
+     */
+    class Collector : public Yothalot::Writer
+    {
+    private:
+        /**
+         *  The combined values
+         *  @var Values::Buffer
+         */
+        Values::Buffer &_values;
+
+    public:
+        /**
+         *  Constructor
+         *  @param  values
+         */
+        Collector(Values::Buffer &values) : _values(values) {}
+
+        /**
+         *  Destructor
+         */
+        virtual ~Collector() = default;
+
+        /**
+         *  Emit a value
+         *  @param  value
+         */
+        virtual void emit(const Yothalot::Value &value) override
+        {
+            // keep the value
+            _values.emplace_back(new Tuple::Copy(value));
+        }
+    };
+
+    /**
+     *  The PHP object with the combine() method
+     *  @var Php::Object
+     */
+    Php::Object &_object;
+
+    /**
+     *  The PHP objects that are passed to combine()
+     *  @var Proxies
+     */
+    Proxies &_proxies;
+
+    /**
+     *  The reducer that writes to the shuffle files
+     *  @var Yothalot::Reducer
+     */
+    Yothalot::Reducer *_reducer = nullptr;
+
+    /**
+     *  The buffered groups, indexed by the serialized key
+     *  @var std::unordered_map
+     */
+    std::unordered_map<std::string,Group> _groups;
+
+    /**
+     *  Estimated number of bytes that are buffered
+     *  @var size_t
+     */
+    size_t _bytes = 0;
+
+    /**
+     *  Max number of bytes that are buffered before combine() is called
+     *  @var size_t
+     */
+    size_t _maxbytes;
+
+    /**
+     *  Pass the values of a group to the shuffle files
+     *  @param  key
+     *  @param  values
+     */
+    void forward(const Yothalot::Key &key, const Values::Buffer &values)
+    {
+        // emit the values with the original key
+        for (auto &value : values) _reducer->emit(key, *value);
+    }
+
+
+public:
+    /**
+     *  Constructor
+     *  @param  object      The PHP object with the combine() method
+     *  @param  proxies     The PHP objects that are passed to combine()
+     *  @param  maxbytes    Max number of bytes that are buffered before combine() is called
+     */
+    Combiner(Php::Object &object, Proxies &proxies, size_t maxbytes) : _object(object), _proxies(proxies), _maxbytes(maxbytes) {}
+
+    /**
+     *  No copying
+     *  @param  that
+     */
+    Combiner(const Combiner &that) = delete;
+
+    /**
+     *  Destructor
+     */
+    virtual ~Combiner() = default;
+
+    /**
+     *  Set the reducer that writes to the shuffle files
+     *  @param  reducer
+     *  @return Combiner
+     */
+    Combiner &target(Yothalot::Reducer &reducer)
+    {
+        // when the target changes, the buffered values belong to the old target
+        if (_reducer != &reducer) flush();
+
+        // store the new target
+        _reducer = &reducer;
+
+        // allow chaining
+        return *this;
+    }
+
+    /**
+     *  Emit a key/value pair, this is called by the mapper
+     *  @param  key
+     *  @param  value
+     */
+    virtual void emit(const Yothalot::Key &key, const Yothalot::Value &value) override
+    {
+        // serialize the key to look up the group
+        Tuple::Index index(key);
+
+        // find the group, or create a new one
+        auto iter = _groups.find(index);
+        if (iter == _groups.end())
+        {
+            // add the group
+            iter = _groups.emplace(std::move(index), Group(key)).first;
+
+            // keep track of the memory that is used by the key
+            _bytes += iter->first.size() + iter->second.key->bytes();
+        }
+
+        // add the value
+        iter->second.values.emplace_back(new Tuple::Copy(value));
+
+        // keep track of the memory that is used by the value
+        _bytes += iter->second.values.back()->bytes();
+
+        // when too much is buffered, we combine what we have
+        if (_bytes > _maxbytes) flush();
+    }
+
+    /**
+     *  Pass all buffered values to the combine() method, if that method fails
+     *  the values that were not combined go to the shuffle files as they are
+     */
+    void flush()
+    {
+        // did combine() fail?
+        bool failed = false;
+
+        // pass all the groups to the combiner
+        for (auto &iter : _groups)
+        {
+            // after a failure the rest is not combined any more
+            if (failed) { forward(*iter.second.key, iter.second.values); continue; }
+
+            // the combined values
+            Values::Buffer combined;
+
+            // prevent PHP exceptions from bubbling up
+            try
+            {
+                // the writer that collects the combined values
+                Collector collector(combined);
+
+                // call the combine method
+                _object.call("combine", Tuple::Php(*iter.second.key), _proxies.values(iter.second.values), _proxies.writer(collector));
+            }
+            catch (const Php::Exception &exception)
+            {
+                // report the problem, the output of the mapper is not lost
+                Php::warning << "combine() failed, values are passed on uncombined: " << exception.what() << std::flush;
+
+                // pass on the original values instead
+                failed = true;
+                forward(*iter.second.key, iter.second.values);
+                continue;
+            }
+
+            // pass on the combined values
+            forward(*iter.second.key, combined);
+        }
+
+        // the buffer is empty
+        _groups.clear();
+        _bytes = 0;
+    }
+
+    /**
+     *  Forget the buffered values and the reducer, this is used when the
+     *  mapper failed, and the reducer is about to be destructed
+     */
+    void reset()
+    {
+        // the buffer is empty
+        _groups.clear();
+        _bytes = 0;
+
+        // the reducer is no longer valid
+        _reducer = nullptr;
+    }
+};
+
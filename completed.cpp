@@ -0,0 +1,39 @@
+/**
+ *  Completed.cpp
+ *
+ *  Implementation of the iterator over completed jobs, simply because
+ *  of a circular reference (the pool creates the object, and the iterator
+ *  needs the pool).
+ *
+ *  @copyright 2016 Copernica BV
+ */
+
+/**
+ *  Dependencies
+ */
+#include <phpcpp.h>
+#include "completed.h"
+#include "job.h"
+#include "pool.h"
+
+/**
+ *  Move to the next position
+ */
+void Completed::Iterator::next()
+{
+    // wait for the next job
+    _current = _pool->next(Deadline());
+
+    // one more job was returned
+    _counter += 1;
+}
+
+/**
+ *  Rewind the iterator to the front position
+ */
+void Completed::Iterator::rewind()
+{
+    // wait for the first job
+    _current = _pool->next(Deadline());
+}
+
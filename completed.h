@@ -0,0 +1,145 @@
+/**
+ *  Completed.h
+ *
+ *  Object that is returned by Yothalot\Pool::completed(), iterating over it
+ *  waits for the jobs in the pool, and returns them in the order in which
+ *  they complete
+ *
+ *  @copyright 2016 Copernica BV
+ */
+
+/**
+ *  Include guard
+ */
+#pragma once
+
+/**
+ *  Dependencies
+ */
+#include <phpcpp.h>
+
+/**
+ *  Forward declaration
+ */
+class Pool;
+
+/**
+ *  Class definition
+ */
+class Completed : public Php::Base, public Php::Traversable
+{
+private:
+    /**
+     *  The iterator over the completed jobs
+     */
+    class Iterator : public Php::Iterator
+    {
+    private:
+        /**
+         *  The pool
+         *  @var Pool
+         */
+        Pool *_pool;
+
+        /**
+         *  The current job
+         *  @var Php::Value
+         */
+        Php::Value _current;
+
+        /**
+         *  Number of jobs that were returned
+         *  @var int64_t
+         */
+        int64_t _counter = 0;
+
+    public:
+        /**
+         *  Constructor
+         *  @param  completed   the object that is iterated over
+         *  @param  pool        the pool
+         */
+        Iterator(Completed *completed, Pool *pool) : Php::Iterator(completed), _pool(pool) {}
+
+        /**
+         *  Destructor
+         */
+        virtual ~Iterator() {}
+
+        /**
+         *  Is the iterator on a valid position
+         *  @return bool
+         */
+        virtual bool valid() override
+        {
+            // there is no job when the pool was empty
+            return !_current.isNull();
+        }
+
+        /**
+         *  The value at the current position
+         *  @return Php::Value
+         */
+        virtual Php::Value current() override
+        {
+            // expose the job
+            return _current;
+        }
+
+        /**
+         *  The key at the current position
+         *  @return Php::Value
+         */
+        virtual Php::Value key() override
+        {
+            // return counter
+            return _counter;
+        }
+
+        /**
+         *  Move to the next position
+         */
+        virtual void next() override;
+
+        /**
+         *  Rewind the iterator to the front position, this waits for the
+         *  first job (the jobs that were already returned are gone)
+         */
+        virtual void rewind() override;
+    };
+
+    /**
+     *  The PHP pool object, so that the pool stays alive
+     *  @var Php::Value
+     */
+    Php::Value _object;
+
+    /**
+     *  The pool
+     *  @var Pool
+     */
+    Pool *_pool;
+
+public:
+    /**
+     *  Constructor
+     *  @param  object      the PHP pool object
+     *  @param  pool        the pool
+     */
+    Completed(const Php::Value &object, Pool *pool) : _object(object), _pool(pool) {}
+
+    /**
+     *  Destructor
+     */
+    virtual ~Completed() = default;
+
+    /**
+     *  Get the iterator
+     *  @return Php::Iterator
+     */
+    virtual Php::Iterator *getIterator() override
+    {
+        return new Iterator(this, _pool);
+    }
+};
+
@@ -44,6 +44,20 @@ private:
      */
     JSON::Object _json;
 
+    /**
+     *  Check whether a format is supported
+     *  @param  format      "json" or "msgpack"
+     *  @throws Php::Exception
+     */
+    static void check(const std::string &format)
+    {
+        // these are the formats that we know
+        if (format == "json" || format == "msgpack") return;
+
+        // report the unknown format to the user
+        throw Php::Exception("unknown format \"" + format + "\", use \"json\" or \"msgpack\"");
+    }
+
 
 public:
     /**
@@ -79,6 +93,12 @@ public:
         
         // the type of feedback mechanism that should be used
         std::string feedback    = (param.contains("feedback")   ? param["feedback"]     : Php::ini_get("yothalot.feedback")    .stringValue());
+
+        // the format in which jobs are published ("json" or "msgpack")
+        std::string format      = (param.contains("format")     ? param["format"]       : Php::ini_get("yothalot.format")      .stringValue());
+
+        // a misspelled format should not silently fall back to json
+        check(format);
         
         // store all properties in the JSON
         _json.set("address", address);
@@ -89,6 +109,7 @@ public:
         _json.set("cache", cache);
         _json.set("maxcache", (int64_t)maxcache);
         _json.set("ttl", (int64_t)ttl);
+        _json.set("format", format);
 
         // creating a connection could throw
         try
@@ -101,6 +122,9 @@ public:
             // convert C++ exception into a PHP exception
             throw Php::Exception(std::string("rabbitmq error: ") + error.what());
         }
+
+        // set the format
+        _rabbit->msgpack(format == "msgpack");
         
         // prevent exceptions for nosql errors
         try
@@ -117,12 +141,24 @@ public:
 
     /**
      *  Flush the connection
-     *  This runs the event loop until everything has been sent
+     *  This runs the event loop until all jobs have been confirmed by RabbitMQ
+     *  @return Php::Value  array with the number of confirmed and nacked jobs
      */
-    void flush()
+    Php::Value flush()
     {
+        // the counters
+        size_t confirmed = 0, nacked = 0;
+
         // call the flush method on the rabbitmq connection
-        _rabbit->flush();
+        _rabbit->flush(confirmed, nacked);
+
+        // construct the result
+        Php::Value result;
+        result["confirmed"] = (int64_t)confirmed;
+        result["nacked"] = (int64_t)nacked;
+
+        // done
+        return result;
     }
 
     /**
@@ -179,12 +215,21 @@ public:
         // @todo do we need this in the json????
         std::string feedback = Php::ini_get("yothalot.feedback");
 
+        // the format in which jobs are published
+        std::string format = (json.contains("format") ? json.c_str("format") : Php::ini_get("yothalot.format"));
+
+        // it must be a supported format
+        check(format);
+
         // creating a connection could throw
         try
         {
             // create the actual connections
             _rabbit = std::make_shared<Rabbit>(std::move(address), std::move(exchange), std::move(mapreduce), std::move(races), std::move(jobs), feedback == "rabbit");
             _cache = std::make_shared<Cache>(std::move(cache), maxcache, ttl);
+
+            // set the format
+            _rabbit->msgpack(format == "msgpack");
         }
         catch (const std::runtime_error &error)
         {
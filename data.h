@@ -19,6 +19,9 @@
 #include "json/array.h"
 #include "algorithm.h"
 #include "revived.h"
+#include "blobs.h"
+#include "bundle.h"
+#include "datasize.h"
 #include <phpcpp.h>
 
 /**
@@ -46,6 +49,71 @@ private:
      */
     Algorithm _algorithm = Algorithm::job;
 
+    /**
+     *  The serialized algorithm that is passed as stdin to the executables
+     *  (only set for jobs that were not unserialized)
+     *  @var std::string
+     */
+    std::string _stdin;
+
+    /**
+     *  Time-to-live of objects in the cache
+     *  @var time_t
+     */
+    time_t _ttl = 0;
+
+    /**
+     *  Algorithms that are bigger than this are stored in the cache, instead
+     *  of being passed inline to the executables
+     *  @var size_t
+     */
+    static const size_t maxinline = 16 * 1024;
+
+    /**
+     *  Number of records and bytes of input that were added to the json
+     *  @var size_t
+     */
+    size_t _inlinerecords = 0;
+    size_t _inlinebytes = 0;
+
+    /**
+     *  The limits after which further input is no longer added to the json
+     *  (the yothalot.maxinlinerecords and yothalot.maxinlinebytes settings)
+     *  @var size_t
+     */
+    size_t _maxinlinerecords = Php::ini_get("yothalot.maxinlinerecords").numericValue();
+    size_t _maxinlinebytes = DataSize(Php::ini_get("yothalot.maxinlinebytes"));
+
+    /**
+     *  Number of bytes of data in a key or value
+     *  @param  tuple
+     *  @return size_t
+     */
+    static size_t bytes(const Yothalot::Tuple &tuple)
+    {
+        // the result
+        size_t result = 0;
+
+        // add the fields, without serializing the tuple
+        for (size_t i = 0; i < tuple.fields(); ++i) result += tuple.isNumber(i) || tuple.isNull(i) ? sizeof(int64_t) : tuple.string(i).size();
+
+        // done
+        return result;
+    }
+
+    /**
+     *  Add an entry to the input array
+     *  @param  object
+     */
+    void append(const JSON::Object &object)
+    {
+        // add it to the input array
+        _input.append(object);
+
+        // the json refers to the same array, so it only has to be set once
+        if (!isArray("input")) set("input", _input);
+    }
+
     /**
      *  Utility class for an executable (the mapper, reducer or finalizer)
      */
@@ -95,6 +163,18 @@ private:
             // find out what the include files are
             auto includes = algo.call("includes");
 
+            // the files may be shipped with the job
+            try
+            {
+                // pack the files
+                if (Bundle::enabled()) includes = Bundle::pack(includes);
+            }
+            catch (const std::runtime_error &error)
+            {
+                // convert C++ exception into a PHP exception
+                throw Php::Exception(error.what());
+            }
+
             // create a simple php array with the includes and the algorithm object
             Php::Value array(Php::Type::Array);
             array[0] = includes;
@@ -114,6 +194,36 @@ private:
         }
     };
     
+    /**
+     *  Stdin for an algorithm that is stored in the cache, it holds the name
+     *  of the stored object instead of the algorithm itself
+     */
+    class Reference : public std::string
+    {
+    public:
+        /**
+         *  Constructor
+         *  @param  name        Name of the stored object
+         *  @param  fallback    File that is used when the object is no longer in the cache
+         */
+        Reference(const std::string &name, const std::string &fallback)
+        {
+            // create a php array that refers to the stored object
+            Php::Value array(Php::Type::Array);
+            array["blob"] = name;
+            array["fallback"] = fallback;
+
+            // serialize and encode it, just like the inline data
+            auto result = Php::call("base64_encode", Php::call("serialize", array));
+
+            // assign the result to the std::string
+            assign(result.stringValue());
+
+            // append some newlines as we should be followed by data
+            append("\n\n");
+        }
+    };
+
     /**
      *  We also have to send the cache settings to the server, that is encapsulated here
      */
@@ -149,6 +259,10 @@ public:
         // construct the input data
         InputData input(cache, algo);
 
+        // remember it, so that it can be moved to the cache later
+        _stdin = input;
+        _ttl = cache->ttl();
+
         // in case we're a map reduce algorithm we set a modulo, mapper, reducer and writer
         if (algo.instanceOf("Yothalot\\RecordReduce") || algo.instanceOf("Yothalot\\MapReduce") || algo.instanceOf("Yothalot\\MapReduce2"))
         {
@@ -235,6 +349,95 @@ public:
         return _php = revived.object();
     }
 
+    /**
+     *  Store the serialized algorithm
+     *  @param  target      The target to store the algorithm in
+     *  @param  data        The serialized algorithm
+     *  @return std::string Name of the stored object
+     */
+    std::string store(Yothalot::Target *target, const std::string &data)
+    {
+        // the record with the algorithm
+        Yothalot::Record record(0);
+        record.add(data);
+
+        // store it
+        Yothalot::Output output(target);
+        output.add(record);
+        output.flush();
+
+        // the name of the stored object
+        auto name = output.name();
+
+        // objects in the cache can be reused by later jobs (objects that did not
+        // fit in the cache end up in the directory of this job, which is removed)
+        if (strncasecmp(name.data(), "cache://", 8) == 0) Blobs::instance().add(data, name, _ttl);
+
+        // done
+        return name;
+    }
+
+    /**
+     *  Store the serialized algorithm in the cache (or reuse the object that
+     *  was stored by an earlier job with the same algorithm), and only pass
+     *  a reference to it to the executables. This is only done for big
+     *  algorithms, and if storing fails it stays inline. The algorithm is
+     *  also written to a file that the workers use if the object is evicted
+     *  from the cache, this file should be discarded when the job is done.
+     *  @param  target      The target to store the algorithm in
+     *  @return std::string Name of the fallback file (empty if there is none)
+     */
+    std::string share(Yothalot::Target *target)
+    {
+        // the name of the fallback file
+        std::string fallback;
+
+        // small algorithms are cheaper to pass inline
+        if (_stdin.size() < maxinline) return fallback;
+
+        // storing could fail
+        try
+        {
+            // the serialized algorithm (without the separator)
+            std::string data(_stdin, 0, _stdin.size() - 2);
+
+            // an earlier job may already have stored it
+            const char *name = Blobs::instance().find(data);
+
+            // the object in the cache
+            std::string stored = name ? std::string(name) : store(target, data);
+
+            // the file that is used when the object is evicted from the cache
+            fallback = Blobs::fallback(data);
+
+            // the stdin that refers to the stored object
+            Reference reference(stored, fallback);
+
+            // pass the reference to all executables
+            if (isMapReduce())
+            {
+                object("mapper").set("stdin", reference);
+                object("reducer").set("stdin", reference);
+                object("finalizer").set("stdin", reference);
+            }
+            else set("stdin", reference);
+        }
+        catch (...)
+        {
+            // the algorithm is still in the json, so the file is not needed
+            if (!fallback.empty()) Blobs::discard(fallback);
+
+            // there is no fallback file
+            fallback.clear();
+        }
+
+        // the algorithm no longer has to be stored
+        _stdin.clear();
+
+        // expose the fallback file
+        return fallback;
+    }
+
     /**
      *  Simple checkers for race and mapreduce
      *
@@ -420,11 +623,12 @@ public:
         // set the data property
         object.set("data", data);
 
-        // and move the data into the input array
-        _input.append(std::move(object));
+        // update the counters
+        _inlinerecords += 1;
+        _inlinebytes += data.size();
 
-        // set the changed input
-        set("input", _input);
+        // and move the data into the input array
+        append(std::move(object));
     }
 
     /**
@@ -454,10 +658,7 @@ public:
         if (server && *server != 0) object.set("server", server);
 
         // move the data into the input array
-        _input.append(std::move(object));
-
-        // set the changed input
-        set("input", _input);
+        append(std::move(object));
     }
 
     /**
@@ -480,11 +681,23 @@ public:
         // set the server if present
         if (server && *server != 0) object.set("server", server);
 
+        // update the counters
+        _inlinerecords += 1;
+        _inlinebytes += bytes(key) + bytes(value);
+
         // move the data into the input array
-        _input.append(std::move(object));
+        append(std::move(object));
+    }
 
-        // set the changed input
-        set("input", _input);
+    /**
+     *  Should further input be stored somewhere else than in the json? This is
+     *  the case when so much input was added that the json would become huge
+     *  @return bool
+     */
+    bool spill() const
+    {
+        // check the limits
+        return _inlinerecords >= _maxinlinerecords || _inlinebytes >= _maxinlinebytes;
     }
 
     /**
@@ -507,28 +720,30 @@ public:
         if (server && *server != 0) object.set("server", server);
 
         // move the data into the input array
-        _input.append(std::move(object));
-
-        // set the changed input
-        set("input", _input);
+        append(std::move(object));
     }
 
     /**
-     *  Set the name of the temporary queue
+     *  Set the name of the reply queue
      *  @param  name
+     *  @param  correlation
      */
-    void tempqueue(const std::string &name)
+    void tempqueue(const std::string &name, const std::string &correlation)
     {
         // two properties are necessary
         set("exchange", "");
         set("routingkey", name);
+
+        // the queue is shared, so the result must be published with the correlation id
+        set("correlation", correlation);
     }
 
     /**
      *  Set the feedback ip and port in the json
      *  @param  address
+     *  @param  correlation
      */
-    void listener(const std::string &address)
+    void listener(const std::string &address, const std::string &correlation)
     {
         // find location of semicolon
         size_t semicolon = address.find(':');
@@ -536,6 +751,9 @@ public:
         // set properties
         set("ip", address.substr(0, semicolon));
         set("port", address.substr(semicolon + 1));
+
+        // the socket is shared, so the result must contain the correlation id
+        set("correlation", correlation);
     }
 };
 
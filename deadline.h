@@ -0,0 +1,111 @@
+/**
+ *  Deadline.h
+ *
+ *  Point in time until which an event loop may block. A default constructed
+ *  deadline never expires.
+ *
+ *  @copyright 2016 Copernica BV
+ */
+
+/**
+ *  Include guard
+ */
+#pragma once
+
+/**
+ *  Dependencies
+ */
+#include <chrono>
+#include <climits>
+
+/**
+ *  Class definition
+ */
+class Deadline
+{
+private:
+    /**
+     *  The clock that is used, it is not affected by changes to the system time
+     */
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     *  The moment the deadline expires
+     *  @var Clock::time_point
+     */
+    Clock::time_point _expires;
+
+    /**
+     *  Does the deadline ever expire?
+     *  @var bool
+     */
+    bool _infinite;
+
+    /**
+     *  Limit a number of seconds to a range that fits in the clock, longer
+     *  timeouts are hardly distinguishable from no timeout at all
+     *  @param  seconds
+     *  @return double
+     */
+    static double clamp(double seconds)
+    {
+        // about ten years, far below the range of the clock (about 292 years)
+        static constexpr double maxseconds = 10.0 * 365 * 24 * 60 * 60;
+
+        // negative numbers are handled by the caller, anything that is not below the maximum (also nan) is the maximum
+        return seconds < maxseconds ? seconds : (double)maxseconds;
+    }
+
+public:
+    /**
+     *  Constructor for a deadline that never expires
+     */
+    Deadline() : _infinite(true) {}
+
+    /**
+     *  Constructor
+     *  @param  seconds     number of seconds from now (a negative number for no deadline)
+     */
+    Deadline(double seconds) :
+        _expires(Clock::now() + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(seconds < 0.0 ? 0.0 : clamp(seconds)))),
+        _infinite(seconds < 0.0) {}
+
+    /**
+     *  Destructor
+     */
+    virtual ~Deadline() = default;
+
+    /**
+     *  Has the deadline passed?
+     *  @return bool
+     */
+    bool expired() const
+    {
+        // compare with the current time
+        return !_infinite && Clock::now() >= _expires;
+    }
+
+    /**
+     *  The number of milliseconds that are left, in the format that is
+     *  expected by epoll_wait() (-1 for no deadline)
+     *  @return int
+     */
+    int timeout() const
+    {
+        // no deadline means that we can block forever
+        if (_infinite) return -1;
+
+        // the time that is left
+        auto left = _expires - Clock::now();
+
+        // the deadline may have passed already
+        if (left <= Clock::duration::zero()) return 0;
+
+        // round up, so that we do not wake up just before the deadline
+        auto milliseconds = std::chrono::duration_cast<std::chrono::milliseconds>(left + std::chrono::milliseconds(1) - Clock::duration(1)).count();
+
+        // epoll_wait() takes an int, a negative number would mean that it blocks forever
+        return milliseconds > INT_MAX ? INT_MAX : (int)milliseconds;
+    }
+};
+
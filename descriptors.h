@@ -1,7 +1,10 @@
 /**
  *  Descriptors.h
  *
- *  Class that collects all filedescriptors that are in use
+ *  Class that collects all filedescriptors that are in use. The descriptors
+ *  are also registered with an epoll instance, that is owned by this object,
+ *  so that the event loop does not have to pass all descriptors to the kernel
+ *  on every iteration.
  *
  *  @author Emiel Bruijntjes <emiel.bruijntjes@copernica.com>    
  *  @author Toon Schoenmakers <toon.schoenmakers@copernica.com>
@@ -17,12 +20,41 @@
  *  Dependencies
  */
 #include <set>
+#include <unistd.h>
+#include <sys/epoll.h>
 
 /**
  *  Class definition
  */
 class Descriptors
 {
+public:
+    /**
+     *  Interface for objects that want to be notified when descriptors are
+     *  added or removed (to maintain an index of descriptors)
+     */
+    class Watcher
+    {
+    public:
+        /**
+         *  Destructor
+         */
+        virtual ~Watcher() = default;
+
+        /**
+         *  Called when a descriptor is added, or when its flags change
+         *  @param  fd
+         *  @param  flags
+         */
+        virtual void onAdded(int fd, int flags) = 0;
+
+        /**
+         *  Called when a descriptor is removed
+         *  @param  fd
+         */
+        virtual void onRemoved(int fd) = 0;
+    };
+
 private:
     /**
      *  Filedescriptors for readability and writability
@@ -43,6 +75,51 @@ private:
      */
     int _highest = 0;
 
+    /**
+     *  The epoll instance (created when the first descriptor is added)
+     *  @var int
+     */
+    mutable int _epoll = -1;
+
+    /**
+     *  The objects that are notified about changes
+     *  @var std::set
+     */
+    mutable std::set<Watcher*> _watchers;
+
+
+    /**
+     *  Register a filedescriptor with the epoll instance
+     *  @param  fd
+     *  @param  flags
+     *  @param  known       was the filedescriptor already registered?
+     */
+    void monitor(int fd, int flags, bool known)
+    {
+        // the events to watch
+        struct epoll_event event;
+        event.events = ((flags & AMQP::readable) ? (uint32_t)EPOLLIN : 0) | ((flags & AMQP::writable) ? (uint32_t)EPOLLOUT : 0);
+        event.data.fd = fd;
+
+        // register or modify the descriptor
+        if (epoll_ctl(epoll(), known ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, fd, &event) == 0) return;
+
+        // a descriptor that was closed and reopened is no longer registered (or
+        // the other way around), so we try again with the other operation
+        epoll_ctl(epoll(), known ? EPOLL_CTL_ADD : EPOLL_CTL_MOD, fd, &event);
+    }
+
+    /**
+     *  The current flags of a filedescriptor
+     *  @param  fd
+     *  @return int
+     */
+    int flags(int fd) const
+    {
+        // check both sets
+        return (_read.count(fd) ? AMQP::readable : 0) | (_write.count(fd) ? AMQP::writable : 0);
+    }
+
 
 public:
     /**
@@ -50,10 +127,68 @@ public:
      */
     Descriptors() = default;
 
+    /**
+     *  No copying, because the epoll instance can not be shared
+     *  @param  that
+     */
+    Descriptors(const Descriptors &that) = delete;
+
     /**
      *  Destructor
      */
-    virtual ~Descriptors() = default;
+    virtual ~Descriptors()
+    {
+        // close the epoll instance
+        if (_epoll >= 0) close(_epoll);
+    }
+
+    /**
+     *  The epoll instance in which all descriptors are registered
+     *  @return int
+     */
+    int epoll() const
+    {
+        // create the instance on first use
+        if (_epoll < 0) _epoll = epoll_create1(EPOLL_CLOEXEC);
+
+        // expose it
+        return _epoll;
+    }
+
+    /**
+     *  Start notifying a watcher about changes, the watcher is immediately
+     *  notified about all descriptors that are already in the set
+     *  @param  watcher
+     */
+    void watch(Watcher *watcher) const
+    {
+        // add the watcher, leap out if it was already there
+        if (!_watchers.insert(watcher).second) return;
+
+        // report the current descriptors
+        for (auto fd : _all) watcher->onAdded(fd, flags(fd));
+    }
+
+    /**
+     *  Stop notifying a watcher, the watcher is told that all descriptors
+     *  are removed
+     *  @param  watcher
+     */
+    void unwatch(Watcher *watcher) const
+    {
+        // remove the watcher, leap out if it was not there
+        if (_watchers.erase(watcher) == 0) return;
+
+        // report that the descriptors are gone
+        for (auto fd : _all) watcher->onRemoved(fd);
+    }
+
+    /**
+     *  Is a filedescriptor in the set?
+     *  @param  fd
+     *  @return bool
+     */
+    bool contains(int fd) const { return _all.count(fd) > 0; }
 
     /**
      *  Cast to boolean
@@ -88,13 +223,8 @@ public:
      */
     void add(const Descriptors &that)
     {
-        // merge all the sets
-        _all.insert(that._all.begin(), that._all.end());
-        _read.insert(that._read.begin(), that._read.end());
-        _write.insert(that._write.begin(), that._write.end());
-        
-        // check highest
-        _highest = std::max(_highest, that._highest);
+        // add all the descriptors with the combined flags
+        for (auto fd : that._all) add(fd, flags(fd) | that.flags(fd));
     }
 
     /**
@@ -107,12 +237,21 @@ public:
         // should we remove instead?
         if (flags == 0) return remove(fd);
 
-        // add to all set
-        _all.insert(fd);
+        // add to all set (and find out if we already had it)
+        bool known = !_all.insert(fd).second;
+
+        // nothing changes if the flags are the same
+        if (known && this->flags(fd) == flags) return;
 
-        // add to appropriate sets
-        if (flags & AMQP::readable) _read.insert(fd);
-        if (flags & AMQP::writable) _write.insert(fd);
+        // add to appropriate sets (and remove from the sets that no longer apply)
+        if (flags & AMQP::readable) _read.insert(fd); else _read.erase(fd);
+        if (flags & AMQP::writable) _write.insert(fd); else _write.erase(fd);
+
+        // register with epoll
+        monitor(fd, flags, known);
+
+        // notify the watchers
+        for (auto *watcher : _watchers) watcher->onAdded(fd, flags);
 
         // was this the highest?
         if (fd > _highest) _highest = fd;
@@ -124,11 +263,17 @@ public:
      */
     void remove(int fd)
     {
-        // remove from all sets
-        _all.erase(fd);
+        // remove from all sets, and leap out if we did not even have it
+        if (_all.erase(fd) == 0) return;
         _read.erase(fd);
         _write.erase(fd);
 
+        // stop watching it (this fails if the descriptor was already closed, which is fine)
+        epoll_ctl(epoll(), EPOLL_CTL_DEL, fd, nullptr);
+
+        // notify the watchers
+        for (auto *watcher : _watchers) watcher->onRemoved(fd);
+
         // was this the highest?
         if (fd != _highest) return;
 
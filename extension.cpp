@@ -28,6 +28,12 @@
 #include "input.h"
 #include "record.h"
 #include "pool.h"
+#include "reduce/sum.h"
+#include "reduce/count.h"
+#include "reduce/min.h"
+#include "reduce/max.h"
+#include "reduce/first.h"
+#include "reduce/concat.h"
 
 /**
  *  The VERSION macro is going to be used as string with surrounded quotes
@@ -81,12 +87,28 @@ extern "C" {
         Php::Class<DataStats>       datastats      ("Yothalot\\DataStats");
         Php::Class<Winner>          winner         ("Yothalot\\Winner");
         Php::Class<Pool>            pool           ("Yothalot\\Pool");
+        Php::Class<Completed>       completed      ("Yothalot\\Completed");
+        Php::Class<Reduce::Sum>     sum            ("Yothalot\\Reduce\\Sum");
+        Php::Class<Reduce::Count>   count          ("Yothalot\\Reduce\\Count");
+        Php::Class<Reduce::Min>     min            ("Yothalot\\Reduce\\Min");
+        Php::Class<Reduce::Max>     max            ("Yothalot\\Reduce\\Max");
+        Php::Class<Reduce::First>   first          ("Yothalot\\Reduce\\First");
+        Php::Class<Reduce::Concat>  concat         ("Yothalot\\Reduce\\Concat");
 
         // register writer functions
         writer.method<&Writer::emit>("emit", {
             Php::ByVal("value", Php::Type::Null)
         });
 
+        // register the methods that consume the remaining values at once
+        values.method<&Values::sum>("sum", {
+        }).method<&Values::count>("count", {
+        }).method<&Values::min>("min", {
+        }).method<&Values::max>("max", {
+        }).method<&Values::chunk>("chunk", {
+            Php::ByVal("size", Php::Type::Numeric)
+        });
+
         // register functions on the reducer
         reducer.method<&Reducer::emit>("emit", {
             Php::ByVal("key", Php::Type::Null),
@@ -145,7 +167,9 @@ extern "C" {
         }).method<&Job::flush>("flush", { // new, v2 behaviour
         }).method<&Job::start>("start", {
         }).method<&Job::detach>("detach", {
-        }).method<&Job::wait>("wait");
+        }).method<&Job::wait>("wait", {
+            Php::ByVal("timeout", Php::Type::Float, false)
+        });
 
         // register the path methods
         path.method<&Path::__construct>("__construct", {
@@ -271,12 +295,33 @@ extern "C" {
               .method<&Winner::runtime> ("runtime");
               
         // register pool method
-        pool.method<&Pool::add>("add", { Php::ByVal("job", "Yothalot\\Job") })
-            .method<&Pool::wait>("wait")
+        pool.method<&Pool::__construct>("__construct", { Php::ByVal("options", Php::Type::Array, false) })
+            .method<&Pool::add>("add", { Php::ByVal("job", "Yothalot\\Job"), Php::ByVal("priority", Php::Type::Null, false), Php::ByVal("callback", Php::Type::Callable, false) })
+            .method<&Pool::wait>("wait", { Php::ByVal("timeout", Php::Type::Float, false) })
             .method<&Pool::fetch>("fetch")
+            .method<&Pool::fetch>("poll")
+            .method<&Pool::fd>("fd")
+            .method<&Pool::process>("process")
+            .method<&Pool::completed>("completed")
             .method<&Pool::size>("size");
 
-        // create the map reduce interface
+        // the built-in reducers that can be returned by the optional nativeReducer() method
+        // of an algorithm, to reduce values without calling into php
+        Php::Interface native("Yothalot\\Reduce\\Native");
+
+        // register the built-in reducers
+        sum.implements(native);
+        count.implements(native);
+        min.implements(native);
+        max.implements(native);
+        first.implements(native);
+        concat.implements(native).method<&Reduce::Concat::__construct>("__construct", {
+            Php::ByVal("separator", Php::Type::String, false)
+        });
+
+        // create the map reduce interface, implementations (and record reduce
+        // implementations) may have an extra mapBatch(array $items, Reducer $reducer)
+        // method that is called with many key/value pairs (or records) at once
         Php::Interface mapreduce("Yothalot\\MapReduce");
 
         // register the interface methods
@@ -309,7 +354,10 @@ extern "C" {
             Php::ByVal("value", Php::Type::Null)
         }).method("includes");
 
-        // we alias MapReduce2 to MapReduce
+        // we alias MapReduce2 to MapReduce, implementations may have an extra
+        // combine($key, Values $values, Writer $writer) method that is run on
+        // the output of each mapper (it is not part of the interface, because
+        // it is optional)
         Php::Interface mapreduce2("Yothalot\\MapReduce2");
         mapreduce2.extends(mapreduce);
 
@@ -354,6 +402,14 @@ extern "C" {
         extension.add(std::move(datastats));
         extension.add(std::move(winner));
         extension.add(std::move(pool));
+        extension.add(std::move(completed));
+        extension.add(std::move(native));
+        extension.add(std::move(sum));
+        extension.add(std::move(count));
+        extension.add(std::move(min));
+        extension.add(std::move(max));
+        extension.add(std::move(first));
+        extension.add(std::move(concat));
 
         // add the init method for use on the command line to our namespace, this
         // will result in `php -r "YothalotInit('mapper');"`
@@ -369,6 +425,12 @@ extern "C" {
         extension.add(Php::Ini{ "yothalot.ttl",          86400                                  });
         extension.add(Php::Ini{ "yothalot.maxcache",     "1MB"                                  });
         extension.add(Php::Ini{ "yothalot.feedback",     "rabbit"                               });
+        extension.add(Php::Ini{ "yothalot.format",       "json"                                 });
+        extension.add(Php::Ini{ "yothalot.maxaggregate", "64MB"                                 });
+        extension.add(Php::Ini{ "yothalot.maxcombine",   "64MB"                                 });
+        extension.add(Php::Ini{ "yothalot.bundle",       0                                      });
+        extension.add(Php::Ini{ "yothalot.maxinlinerecords", 1000                               });
+        extension.add(Php::Ini{ "yothalot.maxinlinebytes", "1MB"                                });
 
         // add the ini property for the base directory
         extension.add(Php::Ini("yothalot.base-directory", ""));
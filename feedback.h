@@ -16,6 +16,7 @@
  *  Dependencies
  */
 #include <amqpcpp.h>
+#include "json/object.h"
 
 /**
  *  Class definition
@@ -32,10 +33,9 @@ public:
         /**
          *  Called when result comes in
          *  @param  queue
-         *  @param  buffer
-         *  @param  size
+         *  @param  result      the parsed result
          */
-        virtual void onReceived(Feedback *queue, const char *buffer, size_t size) = 0;
+        virtual void onReceived(Feedback *queue, const JSON::Object &result) = 0;
         
         /**
          *  Called in case of an error
@@ -58,6 +58,13 @@ protected:
      */
     bool _ready = false;
 
+    /**
+     *  Identifier of the job in the feedback channel (if the channel is
+     *  shared by multiple jobs)
+     *  @var std::string
+     */
+    std::string _id;
+
     /**
      *  Protected constructor
      *  @param  owner       Object that will be notified with the result
@@ -72,8 +79,9 @@ public:
 
     /**
      *  Start consuming data from the temporary queue
+     *  @param  deadline    moment at which we stop waiting
      */
-    virtual void wait() = 0;
+    virtual void wait(const Deadline &deadline) = 0;
     
     /**
      *  The tcp channel that is handling incoming results
@@ -87,6 +95,16 @@ public:
      */
     virtual const std::string &name() const = 0;
     
+    /**
+     *  Identifier of the job in the feedback channel
+     *  @return std::string
+     */
+    const std::string &id() const
+    {
+        // expose member
+        return _id;
+    }
+
     /**
      *  Is the result already available?
      *  @return bool
@@ -3,6 +3,26 @@
  *
  *  The init function that should be called directly on cli.
  *
+ *  Processes are normally started for a single task, and read the task
+ *  input from stdin. When started with `YothalotInit('worker')`, a process
+ *  runs many tasks back to back. It then reads framed tasks from stdin,
+ *  each one starting with a header line:
+ *
+ *      <mode> <modulo> <size>\n
+ *
+ *  followed by <size> bytes that hold exactly the same data as a single
+ *  task process would get on stdin. The <mode> is one of "mapper", "kvmapper",
+ *  "reducer", "finalizer" or "run", the <modulo> is only used by mappers. For
+ *  each task a frame is written to stdout, with a header line:
+ *
+ *      <result> <outputsize> <errorsize> <allocations>\n
+ *
+ *  followed by the output of the task and the error message (if any). The
+ *  <allocations> field holds the number of PHP Reducer, Writer and Values
+ *  objects that were created for the task, which does not depend on the
+ *  number of keys because these objects are reused. The worker stops when
+ *  stdin is closed.
+ *
  *  @author    Toon Schoenmakers <toon.schoenmakers@copernica.com>
  *  @copyright 2015 - 2016 Copernica BV
  */
@@ -17,47 +37,50 @@
 #include "stdin.h"
 #include "tempdir.h"
 #include "cache.h"
+#include "revivedcache.h"
 #include <yothalot.h>
+#include <sstream>
 
 /**
  *  Run the mapper
  *  @param  input       All the input
+ *  @param  mapreduce   The wrapped algorithm
+ *  @param  modulo      Number of reducers
+ *  @param  output      Stream to write the output to
+ *  @param  error       Stream to write errors to
  *  @return int
  */
-static int map(const Stdin &input)
+static int map(Stdin &input, Wrapper &mapreduce, int modulo, std::ostream &output, std::ostream &error)
 {
     // prevent exceptions
     try
     {
-        // wrap the php object
-        Wrapper mapreduce(input.object());
-
-        // get our argv
-        auto argv = Php::GLOBALS["argv"];
-        auto argc = Php::GLOBALS["argc"];
-
-        // modulo is the last argument
-        auto modulo = argc > 1 ? (int)argv.get(argc - 1) : 1;
-
         // get the temp directory
         static TempDir tempdir;
+
+        // values that the wrapper holds back must not outlive this task, also
+        // not when it fails, because they refer to the reducer of the task
+        Wrapper::Scope scope(mapreduce);
         
         // create the task
         Yothalot::MapTask task(base(), &mapreduce, modulo, input.target(), tempdir);
 
-        // add the data to process
-        task.process(input.data(), input.size());
+        // pass the data to process in chunks
+        input.process(task);
+
+        // values that are held back by the combiner must still be written
+        mapreduce.flush();
 
         // show output of mapper process
-        std::cout << task.output();
+        output << task.output();
 
         // done
         return 0;
     }
-    catch (const std::runtime_error &error)
+    catch (const std::runtime_error &exception)
     {
         // report error
-        Php::error << "Mapper error: " << error.what() << std::flush;
+        error << "Mapper error: " << exception.what() << std::flush;
 
         // failure
         return -1;
@@ -68,32 +91,32 @@ static int map(const Stdin &input)
 /**
  *  Run the reducer
  *  @param  input           All the input
+ *  @param  mapreduce       The wrapped algorithm
+ *  @param  output          Stream to write the output to
+ *  @param  error           Stream to write errors to
  *  @return int
  */
-static int reduce(const Stdin &input)
+static int reduce(Stdin &input, Wrapper &mapreduce, std::ostream &output, std::ostream &error)
 {
     // prevent exceptions
     try
     {
-        // wrap php object
-        Wrapper mapreduce(input.object());
-
         // create the task
         Yothalot::ReduceTask task(base(), &mapreduce, input.target(), false);
 
-        // add the data to process
-        task.process(input.data(), input.size());
+        // pass the data to process in chunks
+        input.process(task);
 
         // show output of mapper process
-        std::cout << task.output();
+        output << task.output();
 
         // done
         return 0;
     }
-    catch (const std::runtime_error &error)
+    catch (const std::runtime_error &exception)
     {
         // report error
-        Php::error << "Reducer error: " << error.what() << std::flush;
+        error << "Reducer error: " << exception.what() << std::flush;
 
         // failure
         return -1;
@@ -103,32 +126,32 @@ static int reduce(const Stdin &input)
 /**
  *  Run the writer/finalizer
  *  @param  input           All the input
+ *  @param  mapreduce       The wrapped algorithm
+ *  @param  output          Stream to write the output to
+ *  @param  error           Stream to write errors to
  *  @return int
  */
-static int write(const Stdin &input)
+static int write(Stdin &input, Wrapper &mapreduce, std::ostream &output, std::ostream &error)
 {
     // prevent exceptions
     try
     {
-        // wrap php object
-        Wrapper mapreduce(input.object());
-
         // create the task
         Yothalot::WriteTask task(base(), &mapreduce, input.target(), false);
 
-        // add the data to process
-        task.process(input.data(), input.size());
+        // pass the data to process in chunks
+        input.process(task);
 
         // show output of mapper process
-        std::cout << task.output();
+        output << task.output();
 
         // done
         return 0;
     }
-    catch (const std::runtime_error &error)
+    catch (const std::runtime_error &exception)
     {
         // report error
-        Php::error << "Writer error: " << error.what() << std::flush;
+        error << "Writer error: " << exception.what() << std::flush;
 
         // failure
         return -1;
@@ -139,9 +162,11 @@ static int write(const Stdin &input)
  *  Run a regular job (or a job that is part of a race, which is basically identical
  *  to a race job)
  *  @param  input
+ *  @param  output          Stream to write the output to
+ *  @param  error           Stream to write errors to
  *  @return int
  */
-static int run(const Stdin &input)
+static int run(Stdin &input, std::ostream &output, std::ostream &error)
 {
     // prevent exceptions
     try
@@ -150,30 +175,135 @@ static int run(const Stdin &input)
         auto result = input.object().call("process", Php::call("unserialize", Php::call("base64_decode", Php::Value(input.data(), input.size()))));
 
         // capture the output
-        std::string output = Php::call("ob_get_clean");
+        std::string buffered = Php::call("ob_get_clean");
 
         // did we have output?
-        if (output.size() > 0) throw std::runtime_error(output);
+        if (buffered.size() > 0) throw std::runtime_error(buffered);
 
         // if there's no output, the job generated no output
         if (result.isNull()) return 0;
 
         // serialize the output, so that it can be unserialized at the caller side
-        std::cout << Php::call("base64_encode", Php::call("serialize", result));
+        output << Php::call("base64_encode", Php::call("serialize", result));
 
         // done
         return 0;
     }
-    catch (const std::runtime_error &error)
+    catch (const std::runtime_error &exception)
     {
         // report the error
-        Php::error << "Unexpected output: " << error.what() << std::flush;
+        error << "Unexpected output: " << exception.what() << std::flush;
 
         // failure
         return -1;
     }
 }
 
+/**
+ *  Read the header line of a frame from stdin
+ *  @param  line            the line to fill
+ *  @return bool            false on end of input
+ */
+static bool readline(std::string &line)
+{
+    // start with an empty line
+    line.clear();
+
+    // the header is short, so we simply read byte by byte, this ensures
+    // that we never read beyond the end of the line
+    while (true)
+    {
+        // the character to read
+        char c;
+
+        // read one byte
+        auto bytes = ::read(STDIN_FILENO, &c, 1);
+
+        // try again on signals
+        if (bytes < 0 && errno == EINTR) continue;
+
+        // leap out on errors or end of input
+        if (bytes <= 0) return false;
+
+        // are we at the end of the line?
+        if (c == '\n') return true;
+
+        // append the character
+        line.push_back(c);
+    }
+}
+
+/**
+ *  Run a worker that processes many tasks
+ *  @return int
+ */
+static int worker()
+{
+    // the revived algorithms that were already used
+    RevivedCache cache;
+
+    // the header line of a frame
+    std::string line;
+
+    // keep processing frames until stdin is closed
+    while (readline(line))
+    {
+        // parse the header line
+        std::istringstream header(line);
+        std::string mode; int modulo = 1; size_t size = 0;
+        header >> mode >> modulo >> size;
+
+        // streams to collect the output and errors of the task
+        std::ostringstream output;
+        std::ostringstream error;
+
+        // result variable
+        int result = -1;
+
+        // number of PHP proxy objects that were created before this task
+        size_t allocations = Proxies::allocations();
+
+        // prevent PHP output during the task
+        Php::call("ob_start");
+
+        // prevent exceptions (for example when the header can not be revived)
+        try
+        {
+            // read the input of this task
+            Stdin input(STDIN_FILENO, size, &cache);
+
+            // run the task
+            if (strcasecmp(mode.data(), "run")            == 0) result = run(input, output, error);
+            else if (strcasecmp(mode.data(), "mapper")    == 0 ||
+                     strcasecmp(mode.data(), "kvmapper")  == 0) result = map(input, cache.wrapper(input.revived()), modulo, output, error);
+            else if (strcasecmp(mode.data(), "reducer")   == 0) result = reduce(input, cache.wrapper(input.revived()), output, error);
+            else if (strcasecmp(mode.data(), "finalizer") == 0) result = write(input, cache.wrapper(input.revived()), output, error);
+            else error << "Unknown task: " << mode;
+        }
+        catch (const std::exception &exception)
+        {
+            // report the error (this also catches php exceptions from unserialize())
+            error << exception.what();
+        }
+
+        // capture the output
+        std::string buffered = Php::call("ob_get_clean");
+
+        // we expect the output to be empty
+        if (buffered.size() > 0) { error << "Unexpected output (" << buffered << ")"; result = -1; }
+
+        // the output to send back
+        std::string out = output.str();
+        std::string err = error.str();
+
+        // write the frame
+        std::cout << result << " " << out.size() << " " << err.size() << " " << (Proxies::allocations() - allocations) << "\n" << out << err << std::flush;
+    }
+
+    // done
+    return 0;
+}
+
 /**
  *  Our global init method, mostly used to call directly from cli using something
  *  like `php -r "YothalotInit('mapper');"`
@@ -188,6 +318,9 @@ Php::Value yothalotInit(Php::Parameters &params)
     Php::call("ini_set", "error_log", nullptr); // disable the error_log
     Php::call("ini_set", "display_errors", "stderr");
 
+    // a worker process reads its tasks in frames
+    if (strcasecmp(params[0].rawValue(), "worker") == 0) return worker();
+
     // prevent PHP output during race algorithm
     Php::call("ob_start");
 
@@ -198,12 +331,40 @@ Php::Value yothalotInit(Php::Parameters &params)
     int result = -1;
 
     // the run is the very fist simple task
-    if (strcasecmp(params[0].rawValue(), "run")            == 0) result = run(input);
+    if (strcasecmp(params[0].rawValue(), "run")            == 0) result = run(input, std::cout, Php::error);
     // check the type of task to run that is part of the mapreduce algorithm
     else if (strcasecmp(params[0].rawValue(), "mapper")    == 0 ||
-             strcasecmp(params[0].rawValue(), "kvmapper")  == 0) result = map(input);
-    else if (strcasecmp(params[0].rawValue(), "reducer")   == 0) result = reduce(input);
-    else if (strcasecmp(params[0].rawValue(), "finalizer") == 0) result = write(input);
+             strcasecmp(params[0].rawValue(), "kvmapper")  == 0)
+    {
+        // get our argv
+        auto argv = Php::GLOBALS["argv"];
+        auto argc = Php::GLOBALS["argc"];
+
+        // modulo is the last argument
+        auto modulo = argc > 1 ? (int)argv.get(argc - 1) : 1;
+
+        // wrap the php object
+        Wrapper mapreduce(input.object());
+
+        // run the mapper
+        result = map(input, mapreduce, modulo, std::cout, Php::error);
+    }
+    else if (strcasecmp(params[0].rawValue(), "reducer")   == 0)
+    {
+        // wrap the php object
+        Wrapper mapreduce(input.object());
+
+        // run the reducer
+        result = reduce(input, mapreduce, std::cout, Php::error);
+    }
+    else if (strcasecmp(params[0].rawValue(), "finalizer") == 0)
+    {
+        // wrap the php object
+        Wrapper mapreduce(input.object());
+
+        // run the finalizer
+        result = write(input, mapreduce, std::cout, Php::error);
+    }
 
     // capture the output
     auto output = Php::call("ob_get_clean");
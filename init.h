@@ -19,7 +19,8 @@
 
 /**
  *  Our global init method, mostly used to call directly from cli using something
- *  like `php -r "YothalotInit('mapper');"`
+ *  like `php -r "YothalotInit('mapper');"`, or `php -r "YothalotInit('worker');"`
+ *  for a process that runs many tasks
  *  @param  params
  *  @return Php::Value  Return values are like normal programs really, 0 if success
  *                      something else otherwise.
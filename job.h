@@ -366,12 +366,19 @@ public:
 
     /**
      *  Wait for the job to be ready
-     *  @return         Result value (true or false)
+     *  @param  params  optional number of seconds to wait
+     *  @return         Result object, or null when the timeout expired
      */
-    Php::Value wait()
+    Php::Value wait(Php::Parameters &params)
     {
+        // the moment at which we stop waiting
+        Deadline deadline = params.size() > 0 ? Deadline(params[0].floatValue()) : Deadline();
+
         // did the job execute successfully?
-        bool success = _impl->wait();
+        bool success = _impl->wait(deadline);
+
+        // if the deadline passed before the job was ready, there is no result
+        if (deadline.expired() && !_impl->ready()) return nullptr;
 
         // what algorithm did we just wait for?
         switch (_impl->algorithm())
@@ -399,6 +406,16 @@ public:
         return _impl->ready();
     }
 
+    /**
+     *  Install a callback that is called when the job is finished
+     *  @param  callback
+     */
+    void completion(const std::function<void()> &callback)
+    {
+        // pass on to the implementation
+        _impl->completion(callback);
+    }
+
     /**
      *  Serialize the object to a string
      *  @return std::string
@@ -19,6 +19,7 @@
  *  Dependencies
  */
 #include <limits.h>
+#include <functional>
 #include "data.h"
 #include "tempqueue.h"
 #include "listener.h"
@@ -80,6 +81,33 @@ private:
      */
     Target _target;
 
+    /**
+     *  Target that only uses the cache, for input that no longer fits in the
+     *  json when no regular datafile could be created
+     *  @var Target
+     */
+    std::unique_ptr<Target> _overflow;
+
+    /**
+     *  File with a copy of the algorithm, for when the stored algorithm is
+     *  evicted from the cache (empty if there is no such file)
+     *  @var std::string
+     */
+    std::string _fallback;
+
+    /**
+     *  Did the creation of a regular datafile fail before?
+     *  @var bool
+     */
+    bool _unavailable = false;
+
+    /**
+     *  Did the creation of a datafile in the cache fail before? In that case
+     *  all input stays in the json
+     *  @var bool
+     */
+    bool _nooverflow = false;
+
     /**
      *  The file to which records are written.
      *  @var Yothalot::Output
@@ -92,6 +120,12 @@ private:
      */
     JSON::Object _result;
 
+    /**
+     *  Callback that is called when the job is finished
+     *  @var std::function
+     */
+    std::function<void()> _completion;
+
     
     /**
      *  Was the job an error
@@ -172,18 +206,19 @@ private:
     }
     
     /**
-     *  Called when result comes in
-     *  @param  feedback        the feedback channel
-     *  @param  buffer          the received message
-     *  @param  size            size of the message
+     *  Process the result that came in
+     *  @param  result          the received result
      */
-    virtual void onReceived(Feedback *feedback, const char *buffer, size_t size) override
+    void process(const JSON::Object &result)
     {
         // change state
         _state = state_finished;
+
+        // the workers no longer need the copy of the algorithm
+        discard();
         
         // assign to the result variable
-        _result = JSON::Object(buffer, size);
+        _result = result;
 
         // nothing left to do on error
         if (isError()) return;
@@ -208,6 +243,20 @@ private:
         dir.remove();
     }
     
+    /**
+     *  Called when result comes in
+     *  @param  feedback        the feedback channel
+     *  @param  result          the received result
+     */
+    virtual void onReceived(Feedback *, const JSON::Object &result) override
+    {
+        // process the result
+        process(result);
+
+        // notify the callback
+        if (_completion) _completion();
+    }
+
     /**
      *  Called in case of an error
      *  @param  feedback        the feedback channel
@@ -217,8 +266,29 @@ private:
     {
         // remember that we're in an error state
         _state = state_finished;
+
+        // the copy of the algorithm is no longer needed
+        discard();
+
+        // notify the callback
+        if (_completion) _completion();
     }
     
+    /**
+     *  Remove the file with the copy of the algorithm
+     */
+    void discard()
+    {
+        // is there such a file?
+        if (_fallback.empty()) return;
+
+        // remove it
+        Blobs::discard(_fallback);
+
+        // forget it
+        _fallback.clear();
+    }
+
     /**
      *  Install a new output file
      *  @param  file
@@ -233,6 +303,67 @@ private:
         return file;
     }
 
+    /**
+     *  Construct a datafile for a job that is still initializing. If no regular
+     *  datafile can be created (we remember this, so that we do not try it for
+     *  every record), the input is stored in the json, until there is so much of
+     *  it that we rather store the rest in the cache (if that fails too, the rest
+     *  stays in the json as well)
+     *  @return Yothalot::Output
+     */
+    Yothalot::Output *create()
+    {
+        // try a regular datafile first
+        if (!_unavailable) try
+        {
+            // datafile that is stored in nosql or on disk
+            return install(new Yothalot::Output(&_target));
+        }
+        catch (...)
+        {
+            // remember that this is not possible
+            _unavailable = true;
+        }
+
+        // small amounts of input are stored in the json, and so is all input if
+        // the cache could not be used before
+        if (_nooverflow || !_json.spill()) return nullptr;
+
+        // the cache could be unavailable too
+        try
+        {
+            // construct a target that only uses the cache
+            if (_overflow == nullptr) _overflow.reset(new Target(_cache));
+
+            // create the datafile in the cache
+            return install(new Yothalot::Output(_overflow.get()));
+        }
+        catch (...)
+        {
+            // remember this, so that we do not try it again for every record
+            _nooverflow = true;
+
+            // the input stays in the json
+            return nullptr;
+        }
+    }
+
+    /**
+     *  Start a new datafile when the current one only lives in the cache and
+     *  is about to become too big for it
+     */
+    void rotate()
+    {
+        // only relevant for datafiles in the overflow target
+        if (_overflow == nullptr || _state != state_initialize || _datafile == nullptr) return;
+
+        // is there still room in the cache?
+        if (_datafile->size() < _cache->maxsize() / 2) return;
+
+        // store a reference in the json, the next record goes to a new datafile
+        sync(false);
+    }
+
     /**
      *  Get access to the input file
      *  @return Yothalot::Output
@@ -247,7 +378,7 @@ private:
         {
             // if we're still initializing, and this is the only object with access to the
             // json, we can still construct datafiles that are either stored in nosql or on disk
-            if (_state == state_initialize) return install(new Yothalot::Output(&_target));
+            if (_state == state_initialize) return create();
 
             // the only situation that we can deal is when the object is frozen, the other
             // cases (process is already running or completed) do not allow adding extra data
@@ -349,7 +480,11 @@ public:
     /**
      *  Destructor
      */
-    virtual ~JobImpl() = default;
+    virtual ~JobImpl()
+    {
+        // a job that is still running might still need the copy of the algorithm
+        if (_state != state_running) discard();
+    }
 
     /**
      *  Simple checkers for race and mapreduce
@@ -608,6 +743,9 @@ public:
 
             // put this in the output file
             file->add(record);
+
+            // the file might have become too big
+            rotate();
         }
 
         // done
@@ -645,6 +783,9 @@ public:
         {
             // add to the file
             file->add(Yothalot::Record(Yothalot::KeyValue(key, value)));
+
+            // the file might have become too big
+            rotate();
         }
 
         // we've successfully added it
@@ -706,12 +847,15 @@ public:
             _feedback.reset(_rabbit->feedback() ? (Feedback *)new TempQueue(this, _rabbit) : (Feedback *)new Listener(this));
 
             // store the name or location of the feedback channel in the JSON
-            if (_rabbit->feedback()) _json.tempqueue(_feedback->name());
-            else _json.listener(_feedback->name());
+            if (_rabbit->feedback()) _json.tempqueue(_feedback->name(), _feedback->id());
+            else _json.listener(_feedback->name(), _feedback->id());
 
             // before we start the job, we must ensure that all data is on disk or in nosq
             sync(false);
 
+            // big algorithms are stored once in the cache instead of three times in the json
+            _fallback = _json.share(&_target);
+
             // now we must synchronize the json with the datafile that we use (if this is a nosql
             // based datafile, the json has to be updated), and send the job data to RabbitMQ
             if (_json.publish(_rabbit.get())) 
@@ -750,11 +894,22 @@ public:
         return _state == state_finished;
     }
 
+    /**
+     *  Install a callback that is called when the job is finished
+     *  @param  callback
+     */
+    void completion(const std::function<void()> &callback)
+    {
+        // store the callback
+        _completion = callback;
+    }
+
     /**
      *  Wait for the job to be ready
+     *  @param  deadline    moment at which we stop waiting
      *  @return bool
      */
-    bool wait()
+    bool wait(const Deadline &deadline = Deadline())
     {
         // if the job is already done
         if (_state == state_finished) return !isError();
@@ -766,7 +921,7 @@ public:
         if (_feedback == nullptr) return false;
 
         // wait for the result to appear in the feedback channel
-        _feedback->wait();
+        _feedback->wait(deadline);
 
         // by now we know that we're done
         return !isError();
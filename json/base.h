@@ -222,6 +222,7 @@ public:
      */
     friend class Object;
     friend class Array;
+    friend class MsgPack;
 };
 
 /**
@@ -0,0 +1,348 @@
+/**
+ *  MsgPack.cpp
+ *
+ *  Implementation of the MessagePack conversion
+ *
+ *  @copyright 2016 Copernica BV
+ */
+
+/**
+ *  Dependencies
+ */
+#include "msgpack.h"
+#include <string.h>
+
+/**
+ *  Set up namespace
+ */
+namespace JSON {
+
+/**
+ *  Append an integer in big endian byte order
+ *  @param  output
+ *  @param  marker      the type marker that comes first
+ *  @param  value
+ *  @param  bytes       number of bytes
+ */
+static void append(std::string &output, unsigned char marker, uint64_t value, size_t bytes)
+{
+    // the marker
+    output.push_back(marker);
+
+    // the value, most significant byte first
+    for (size_t i = bytes; i > 0; --i) output.push_back((char)(value >> ((i - 1) * 8)));
+}
+
+/**
+ *  Append the header of a string, array or map
+ *  @param  output
+ *  @param  size        number of bytes or elements
+ *  @param  fixed       marker for small sizes, or 0 if there is no such marker
+ *  @param  limit       max size that fits in the fixed marker
+ *  @param  marker8     marker for an 8 bit size, or 0 if there is no such marker
+ *  @param  marker16    marker for a 16 bit size
+ *  @param  marker32    marker for a 32 bit size
+ */
+static void header(std::string &output, size_t size, unsigned char fixed, size_t limit, unsigned char marker8, unsigned char marker16, unsigned char marker32)
+{
+    if (size < limit) output.push_back(fixed | size);
+    else if (marker8 && size <= 0xff) append(output, marker8, size, 1);
+    else if (size <= 0xffff) append(output, marker16, size, 2);
+    else append(output, marker32, size, 4);
+}
+
+/**
+ *  Read an integer in big endian byte order
+ *  @param  buffer
+ *  @param  size
+ *  @param  pos         current position, is updated
+ *  @param  bytes       number of bytes
+ *  @param  value       the value that is read
+ *  @return bool
+ */
+static bool read(const char *buffer, size_t size, size_t &pos, size_t bytes, uint64_t &value)
+{
+    // check the size
+    if (size - pos < bytes) return false;
+
+    // read the value, most significant byte first
+    value = 0;
+    for (size_t i = 0; i < bytes; ++i) value = (value << 8) | (unsigned char)buffer[pos++];
+
+    // done
+    return true;
+}
+
+/**
+ *  Append a value to the output
+ *  @param  value
+ *  @param  output
+ */
+void MsgPack::encode(json_object *value, std::string &output)
+{
+    switch (json_object_get_type(value)) {
+    case json_type_boolean:
+        // true or false
+        output.push_back(json_object_get_boolean(value) ? (char)0xc3 : (char)0xc2);
+        break;
+
+    case json_type_int: {
+        // the integer
+        int64_t number = json_object_get_int64(value);
+
+        // use the smallest representation
+        if (number >= 0 && number < 128) output.push_back((char)number);
+        else if (number >= 0 && number <= 0xff) append(output, 0xcc, number, 1);
+        else if (number >= 0 && number <= 0xffff) append(output, 0xcd, number, 2);
+        else if (number >= 0 && number <= 0xffffffff) append(output, 0xce, number, 4);
+        else if (number >= 0) append(output, 0xcf, number, 8);
+        else if (number >= -32) output.push_back((char)number);
+        else if (number >= INT8_MIN) append(output, 0xd0, (uint8_t)number, 1);
+        else if (number >= INT16_MIN) append(output, 0xd1, (uint16_t)number, 2);
+        else if (number >= INT32_MIN) append(output, 0xd2, (uint32_t)number, 4);
+        else append(output, 0xd3, (uint64_t)number, 8);
+        break;
+    }
+
+    case json_type_double: {
+        // the double, as 64 bit integer
+        double number = json_object_get_double(value);
+        uint64_t bits;
+        memcpy(&bits, &number, sizeof(bits));
+
+        // add it
+        append(output, 0xcb, bits, 8);
+        break;
+    }
+
+    case json_type_string: {
+        // the string
+        size_t size = json_object_get_string_len(value);
+
+        // add the header and the data
+        header(output, size, 0xa0, 32, 0xd9, 0xda, 0xdb);
+        output.append(json_object_get_string(value), size);
+        break;
+    }
+
+    case json_type_array: {
+        // the number of elements
+        size_t size = json_object_array_length(value);
+
+        // add the header and the elements
+        header(output, size, 0x90, 16, 0, 0xdc, 0xdd);
+        for (size_t i = 0; i < size; ++i) encode(json_object_array_get_idx(value, i), output);
+        break;
+    }
+
+    case json_type_object: {
+        // add the header
+        header(output, json_object_object_length(value), 0x80, 16, 0, 0xde, 0xdf);
+
+        // add the keys and values
+        json_object_object_foreach(value, key, member)
+        {
+            // the key
+            size_t size = strlen(key);
+            header(output, size, 0xa0, 32, 0xd9, 0xda, 0xdb);
+            output.append(key, size);
+
+            // the value
+            encode(member, output);
+        }
+        break;
+    }
+
+    default:
+        // null
+        output.push_back((char)0xc0);
+        break;
+    }
+}
+
+/**
+ *  Decode a value from the buffer
+ *  @param  buffer
+ *  @param  size
+ *  @param  pos         current position, is updated
+ *  @param  depth       current nesting depth
+ *  @param  value       the decoded value with a refcount of one (nullptr for null)
+ *  @return bool        was the value valid?
+ */
+bool MsgPack::decode(const char *buffer, size_t size, size_t &pos, size_t depth, json_object *&value)
+{
+    // nothing decoded yet
+    value = nullptr;
+
+    // check the limits
+    if (pos >= size || depth > maxdepth) return false;
+
+    // the marker
+    unsigned char marker = buffer[pos++];
+
+    // number of elements or bytes, and the value of integers
+    uint64_t count = 0, number = 0;
+
+    // is it a string, an array or a map?
+    enum { string, array, map } kind;
+
+    // positive fixint
+    if (marker < 0x80) return (value = json_object_new_int64(marker)) != nullptr;
+
+    // fixmap, fixarray and fixstr
+    if (marker < 0x90) { kind = map; count = marker & 0x0f; }
+    else if (marker < 0xa0) { kind = array; count = marker & 0x0f; }
+    else if (marker < 0xc0) { kind = string; count = marker & 0x1f; }
+
+    // negative fixint
+    else if (marker >= 0xe0) return (value = json_object_new_int64((int8_t)marker)) != nullptr;
+
+    // the other types
+    else switch (marker) {
+    case 0xc0: return true;
+    case 0xc2: return (value = json_object_new_boolean(false)) != nullptr;
+    case 0xc3: return (value = json_object_new_boolean(true)) != nullptr;
+    case 0xc4: case 0xd9: kind = string; if (!read(buffer, size, pos, 1, count)) return false; break;
+    case 0xc5: case 0xda: kind = string; if (!read(buffer, size, pos, 2, count)) return false; break;
+    case 0xc6: case 0xdb: kind = string; if (!read(buffer, size, pos, 4, count)) return false; break;
+    case 0xdc: kind = array; if (!read(buffer, size, pos, 2, count)) return false; break;
+    case 0xdd: kind = array; if (!read(buffer, size, pos, 4, count)) return false; break;
+    case 0xde: kind = map; if (!read(buffer, size, pos, 2, count)) return false; break;
+    case 0xdf: kind = map; if (!read(buffer, size, pos, 4, count)) return false; break;
+    case 0xcc: return read(buffer, size, pos, 1, number) && (value = json_object_new_int64(number)) != nullptr;
+    case 0xcd: return read(buffer, size, pos, 2, number) && (value = json_object_new_int64(number)) != nullptr;
+    case 0xce: return read(buffer, size, pos, 4, number) && (value = json_object_new_int64(number)) != nullptr;
+    case 0xcf: return read(buffer, size, pos, 8, number) && (value = json_object_new_int64(number)) != nullptr;
+    case 0xd0: return read(buffer, size, pos, 1, number) && (value = json_object_new_int64((int8_t)number)) != nullptr;
+    case 0xd1: return read(buffer, size, pos, 2, number) && (value = json_object_new_int64((int16_t)number)) != nullptr;
+    case 0xd2: return read(buffer, size, pos, 4, number) && (value = json_object_new_int64((int32_t)number)) != nullptr;
+    case 0xd3: return read(buffer, size, pos, 8, number) && (value = json_object_new_int64((int64_t)number)) != nullptr;
+    case 0xca: {
+        // 32 bit float
+        if (!read(buffer, size, pos, 4, number)) return false;
+        uint32_t bits = number; float result;
+        memcpy(&result, &bits, sizeof(result));
+        return (value = json_object_new_double(result)) != nullptr;
+    }
+    case 0xcb: {
+        // 64 bit float
+        if (!read(buffer, size, pos, 8, number)) return false;
+        double result;
+        memcpy(&result, &number, sizeof(result));
+        return (value = json_object_new_double(result)) != nullptr;
+    }
+    default:
+        // extension types are not supported
+        return false;
+    }
+
+    // strings are copied from the buffer
+    if (kind == string)
+    {
+        // check the size
+        if (size - pos < count) return false;
+
+        // create the string
+        value = json_object_new_string_len(buffer + pos, count);
+        pos += count;
+        return value != nullptr;
+    }
+
+    // each element takes at least one byte, so bigger counts are invalid
+    if (count > size - pos) return false;
+
+    // create the array or object
+    value = kind == array ? json_object_new_array() : json_object_new_object();
+
+    // decode the elements
+    for (uint64_t i = 0; i < count; ++i)
+    {
+        // the key of map elements
+        std::string key;
+
+        // maps have a key first
+        if (kind == map)
+        {
+            // decode the key
+            json_object *decoded;
+            bool valid = decode(buffer, size, pos, depth + 1, decoded);
+
+            // keys must be strings (or numbers, which are converted)
+            valid = valid && decoded != nullptr && json_object_get_type(decoded) != json_type_object && json_object_get_type(decoded) != json_type_array;
+
+            // store the key
+            if (valid) key = Base::toString(decoded);
+            if (decoded) json_object_put(decoded);
+
+            // leap out on failure
+            if (!valid) break;
+        }
+
+        // decode the element
+        json_object *element;
+        if (!decode(buffer, size, pos, depth + 1, element)) break;
+
+        // add the element
+        if (kind == array) json_object_array_add(value, element);
+        else json_object_object_add(value, key.data(), element);
+
+        // was this the last element?
+        if (i + 1 == count) return true;
+    }
+
+    // empty arrays and maps are valid
+    if (count == 0) return true;
+
+    // one of the elements was invalid
+    json_object_put(value);
+    value = nullptr;
+    return false;
+}
+
+/**
+ *  Encode a JSON value
+ *  @param  value
+ *  @return std::string
+ */
+std::string MsgPack::encode(const Base &value)
+{
+    // the result
+    std::string output;
+
+    // encode the value
+    encode(value._json, output);
+
+    // done
+    return output;
+}
+
+/**
+ *  Decode an object
+ *  @param  buffer
+ *  @param  size
+ *  @return Object
+ */
+Object MsgPack::decode(const char *buffer, size_t size)
+{
+    // start at the front
+    size_t pos = 0;
+
+    // decode the value
+    json_object *value;
+    decode(buffer, size, pos, 0, value);
+
+    // wrap it in an object (this increments the refcount if it is an object)
+    Object result(value);
+
+    // release our reference
+    if (value) json_object_put(value);
+
+    // done
+    return result;
+}
+
+/**
+ *  End of namespace
+ */
+}
+
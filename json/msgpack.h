@@ -0,0 +1,112 @@
+/**
+ *  MsgPack.h
+ *
+ *  Conversion between JSON objects and MessagePack, a binary format that
+ *  holds the same data, but that is more compact and faster to build and
+ *  to parse
+ *
+ *  @copyright 2016 Copernica BV
+ */
+
+/**
+ *  Include guard
+ */
+#pragma once
+
+/**
+ *  Dependencies
+ */
+#include "object.h"
+#include <string>
+
+/**
+ *  Set up namespace
+ */
+namespace JSON {
+
+/**
+ *  Class definition
+ */
+class MsgPack
+{
+private:
+    /**
+     *  Max nesting depth of decoded values
+     *  @var size_t
+     */
+    static const size_t maxdepth = 512;
+
+    /**
+     *  Append a value to the output
+     *  @param  value
+     *  @param  output
+     */
+    static void encode(json_object *value, std::string &output);
+
+    /**
+     *  Decode a value from the buffer
+     *  @param  buffer
+     *  @param  size
+     *  @param  pos         current position, is updated
+     *  @param  depth       current nesting depth
+     *  @param  value       the decoded value with a refcount of one (nullptr for null)
+     *  @return bool        was the value valid?
+     */
+    static bool decode(const char *buffer, size_t size, size_t &pos, size_t depth, json_object *&value);
+
+public:
+    /**
+     *  The content type of MessagePack data
+     *  @var const char *
+     */
+    static const char *contentType() { return "application/x-msgpack"; }
+
+    /**
+     *  Encode a JSON value
+     *  @param  value
+     *  @return std::string
+     */
+    static std::string encode(const Base &value);
+
+    /**
+     *  Does the buffer hold an encoded object? A JSON object always starts
+     *  with a '{', a MessagePack object with a map marker
+     *  @param  buffer
+     *  @param  size
+     *  @return bool
+     */
+    static bool detect(const char *buffer, size_t size)
+    {
+        // check the first byte
+        unsigned char first = size > 0 ? buffer[0] : 0;
+
+        // fixmap, map16 or map32
+        return (first & 0xf0) == 0x80 || first == 0xde || first == 0xdf;
+    }
+
+    /**
+     *  Decode an object
+     *  @param  buffer
+     *  @param  size
+     *  @return Object      an empty object if the data was invalid
+     */
+    static Object decode(const char *buffer, size_t size);
+
+    /**
+     *  Parse an object that is either encoded as MessagePack or as JSON
+     *  @param  buffer
+     *  @param  size
+     *  @return Object
+     */
+    static Object parse(const char *buffer, size_t size)
+    {
+        // check the format
+        return detect(buffer, size) ? decode(buffer, size) : Object(buffer, size);
+    }
+};
+
+/**
+ *  End of namespace
+ */
+}
+
@@ -1,7 +1,8 @@
 /**
  *  Loop.h
  *
- *  Simple event loop implementation
+ *  Simple event loop implementation, based on the epoll instance that is
+ *  maintained by the Descriptors object
  *
  *  @author    Toon Schoenmakers <toon.schoenmakers@copernica.com>
  *  @copyright 2015 - 2016 Copernica BV
@@ -16,9 +17,10 @@
  *  Dependencies
  */
 #include <amqpcpp.h>
-#include <set>
-#include <sys/select.h>
-#include "fdset.h"
+#include <errno.h>
+#include <sys/epoll.h>
+#include "descriptors.h"
+#include "deadline.h"
 
 /** 
  *  We use the _1, _2, _3 placeholders
@@ -43,6 +45,12 @@ private:
      */
     bool _active = false;
 
+    /**
+     *  Max number of events that are processed per step
+     *  @var int
+     */
+    static const int maxevents = 256;
+
 public:
     /**
      *  Constructor
@@ -67,23 +75,28 @@ public:
      *  @param  block           Is it ok to block?
      *  @return bool            Was there any activity?
      */
-    int step(const std::function<void(int,int)> &callback, bool block = true)
+    bool step(const std::function<void(int,int)> &callback, bool block = true)
+    {
+        // pass on, not blocking means a deadline that has already passed
+        return block ? step(callback, Deadline()) : step(callback, Deadline(0.0));
+    }
+
+    /**
+     *  Do a single loop step, blocking no longer than the deadline
+     *  @param  callback        Callback method
+     *  @param  deadline        Moment until which the step may block
+     *  @return bool            Was there any activity?
+     */
+    bool step(const std::function<void(int,int)> &callback, const Deadline &deadline)
     {
         // is there something to check?
         if (!_descriptors) return false;
         
-        // the readable and writable sets
-        FdSet readable(_descriptors.readable());
-        FdSet writable(_descriptors.writable());
-        
-        // construct a timeout
-        struct timeval timeout;
-        
-        // timeout of zero seconds
-        memset(&timeout, 0, sizeof(struct timeval));
+        // the events that are reported
+        struct epoll_event events[maxevents];
 
-        // wait for the sets
-        auto result = select(_descriptors.highest() + 1, readable, writable, nullptr, block ? nullptr : &timeout);
+        // wait for activity
+        auto result = epoll_wait(_descriptors.epoll(), events, maxevents, deadline.timeout());
 
         // on signal errors we still return true because the event loop is still valid,
         // and calling step() again is meaningful
@@ -95,24 +108,23 @@ public:
         // big problems on all other errors
         if (result < 0) return false;
 
-        // check which filedescriptors is readable
-        for (auto fd : _descriptors)
+        // process all active filedescriptors
+        for (int i = 0; i < result; ++i)
         {
-            // the readable + writable flags
-            int flags = 0;
+            // the active filedescriptor
+            int fd = events[i].data.fd;
 
-            // is this filedescriptor readable or writable
-            if (readable.contains(fd)) flags |= AMQP::readable;
-            if (writable.contains(fd)) flags |= AMQP::writable;
+            // an earlier callback may have removed the descriptor
+            if (!_descriptors.contains(fd)) continue;
 
-            // skip if not active
-            if (flags == 0) continue;
+            // the readable + writable flags (errors and hangups are reported
+            // as readability, just like select() does)
+            int flags = 0;
+            if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) flags |= AMQP::readable;
+            if (events[i].events & (EPOLLOUT | EPOLLERR)) flags |= AMQP::writable;
 
             // notify the callback
             callback(fd, flags);
-
-            // jump out of loop - connection might no longer exist
-            break;
         }
 
         // we are ready, and there was activity
@@ -152,6 +164,18 @@ public:
         return step(std::bind(&AMQP::TcpConnection::process, connection, _1, _2));
     }
 
+    /**
+     *  Do a single loop step, blocking no longer than the deadline
+     *  @param  connection      The connection
+     *  @param  deadline        Moment until which the step may block
+     *  @return bool            True if there was activity
+     */
+    bool step(AMQP::TcpConnection *connection, const Deadline &deadline)
+    {
+        // pass on
+        return step(std::bind(&AMQP::TcpConnection::process, connection, _1, _2), deadline);
+    }
+
     /**
      *  Run the event loop
      *  @param  connection      The connection
@@ -4,6 +4,20 @@
  *  Class that can group multiple running Yothalot jobs, and that waits
  *  for the first job in the pool that is ready
  *
+ *  The pool keeps an index of all filedescriptors of the tcp handlers of
+ *  the jobs, so that activity on a filedescriptor is passed to only the
+ *  handler that owns it, and it keeps a queue of jobs that are finished,
+ *  so that finding a ready job does not require checking all jobs.
+ *
+ *  The number of jobs that run at the same time can be limited with the
+ *  "maxrunning" option. Jobs that are added when the limit is reached are
+ *  held in the pool, and are started (highest priority first) when earlier
+ *  jobs complete.
+ *
+ *  A callback can be passed when a job is added. Such a job is not returned
+ *  by wait() or fetch(), the callback is called with the job instead as soon
+ *  as the pool notices that it is ready.
+ *
  *  @author Emiel Bruijntjes <emiel.bruijntjes@copernica.com>
  *  copyright 2016 Copernica BV
  */
@@ -13,12 +27,96 @@
  */
 #pragma once
 
+/**
+ *  Dependencies
+ */
+#include <algorithm>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <set>
+#include <unordered_map>
+#include "completed.h"
+
 /**
  *  Class definition
  */
 class Pool : public Php::Base, public Php::Countable
 {
 private:
+    /**
+     *  Helper class that keeps the index up to date with the filedescriptors
+     *  of one tcp handler
+     */
+    class Handler : public Descriptors::Watcher
+    {
+    private:
+        /**
+         *  The pool
+         *  @var Pool
+         */
+        Pool *_pool;
+
+        /**
+         *  The tcp handler
+         *  @var TcpHandler
+         */
+        TcpHandler *_handler;
+
+    public:
+        /**
+         *  Number of jobs in the pool that use this handler
+         *  @var size_t
+         */
+        size_t jobs = 0;
+
+        /**
+         *  Constructor
+         *  @param  pool
+         *  @param  handler
+         */
+        Handler(Pool *pool, TcpHandler *handler) : _pool(pool), _handler(handler)
+        {
+            // start watching the descriptors
+            handler->descriptors().watch(this);
+        }
+
+        /**
+         *  Destructor
+         */
+        virtual ~Handler()
+        {
+            // stop watching the descriptors
+            _handler->descriptors().unwatch(this);
+        }
+
+        /**
+         *  Called when a descriptor is added, or when its flags change
+         *  @param  fd
+         *  @param  flags
+         */
+        virtual void onAdded(int fd, int flags) override
+        {
+            // watch the descriptor in the pool too
+            _pool->_descriptors.add(fd, flags);
+
+            // remember who owns it
+            _pool->_index[fd] = _handler;
+        }
+
+        /**
+         *  Called when a descriptor is removed
+         *  @param  fd
+         */
+        virtual void onRemoved(int fd) override
+        {
+            // forget about the descriptor
+            _pool->_descriptors.remove(fd);
+            _pool->_index.erase(fd);
+        }
+    };
+
     /**
      *  All jobs that are being monitored by this pool
      *  @var std::map
@@ -26,21 +124,220 @@ private:
     std::map<Job*,Php::Value> _jobs;
 
     /**
-     *  Set of all TCP handles via which data can come one
+     *  All TCP handles via which data can come one
+     *  @var std::map
+     */
+    std::map<TcpHandler*,std::unique_ptr<Handler>> _handlers;
+
+    /**
+     *  The filedescriptors of all handlers
+     *  @var Descriptors
+     */
+    Descriptors _descriptors;
+
+    /**
+     *  The handler that owns each filedescriptor
+     *  @var std::unordered_map
+     */
+    std::unordered_map<int,TcpHandler*> _index;
+
+    /**
+     *  The jobs that are ready, but that were not yet returned
+     *  @var std::deque
+     */
+    std::deque<Job*> _ready;
+
+    /**
+     *  The callbacks of the jobs that were added with a callback
+     *  @var std::map
+     */
+    std::map<Job*,Php::Value> _callbacks;
+
+    /**
+     *  The jobs with a callback that are ready, but for which the callback
+     *  was not yet called
+     *  @var std::deque
+     */
+    std::deque<Job*> _done;
+
+    /**
+     *  The jobs that were added, but that are not yet started, by priority
+     *  (jobs with the same priority are started in the order they were added)
+     *  @var std::multimap
+     */
+    std::multimap<int64_t,Job*,std::greater<int64_t>> _queued;
+
+    /**
+     *  Max number of jobs in the pool that run at the same time (0 for no limit)
+     *  @var size_t
+     */
+    size_t _maxrunning = 0;
+
+    /**
+     *  The jobs in the pool that are running
      *  @var std::set
      */
-    std::set<TcpHandler*> _handlers;
-    
-    
+    std::set<Job*> _running;
+
+    /**
+     *  The handler that is used by each job that was counted in the jobs
+     *  property of that handler
+     *  @var std::map
+     */
+    std::map<Job*,TcpHandler*> _users;
+
+
     /**
      *  Called when a filedescriptor becomes active
      *  @param  fd      the active filedescriptor
      *  @param  flags   readability/writabilitie flags
      */
-    void process(int fd, int flags) const
+    void dispatch(int fd, int flags)
+    {
+        // find the handler that owns the descriptor
+        auto iter = _index.find(fd);
+
+        // pass on to the handler
+        if (iter != _index.end()) iter->second->process(fd, flags);
+    }
+
+    /**
+     *  Remove a job from the pool
+     *  @param  job
+     */
+    void remove(Job *job)
+    {
+        // the job no longer has to report to us
+        job->completion(nullptr);
+
+        // the job is no longer running (the completion callback is gone, so
+        // it is not going to do this itself)
+        _running.erase(job);
+
+        // find the handler that was counted for this job
+        auto user = _users.find(job);
+
+        // jobs that were never counted do not affect the handlers
+        if (user != _users.end())
+        {
+            // find the handler
+            auto iter = _handlers.find(user->second);
+
+            // if this was the last job for the handler, we stop watching it
+            if (iter != _handlers.end() && --iter->second->jobs == 0) _handlers.erase(iter);
+
+            // the job is no longer counted
+            _users.erase(user);
+        }
+
+        // forget the job
+        _jobs.erase(job);
+        _callbacks.erase(job);
+    }
+
+    /**
+     *  Start a job, and monitor it until it is ready
+     *  @param  job
+     */
+    void launch(Job *job)
     {
-        // check all tcp handlers
-        for (const auto &handler : _handlers) handler->process(fd, flags);
+        // the queue to which the job goes when it is ready
+        auto *queue = _callbacks.count(job) > 0 ? &_done : &_ready;
+
+        // start the job, a job that can not be started is ready immediately
+        // (the error is reported when the user waits for it)
+        if (!job->start().boolValue() || job->ready()) { queue->push_back(job); return; }
+
+        // the job is running
+        _running.insert(job);
+
+        // it tells us when it is finished
+        job->completion([this, job, queue]() {
+
+            // the job is ready, and no longer running
+            queue->push_back(job);
+            _running.erase(job);
+        });
+
+        // the tcp handler of the job
+        auto *handler = job->handler();
+
+        // jobs without a handler can not report back
+        if (handler == nullptr) return;
+
+        // find the handler, or start watching it
+        auto &entry = _handlers[handler];
+        if (!entry) entry.reset(new Handler(this, handler));
+
+        // one more job uses it
+        entry->jobs += 1;
+
+        // remember that the job was counted
+        _users[job] = handler;
+    }
+
+    /**
+     *  Start the queued jobs for which there is room
+     */
+    void admit()
+    {
+        // start jobs until the limit is reached
+        while (!_queued.empty() && (_maxrunning == 0 || _running.size() < _maxrunning))
+        {
+            // take the job with the highest priority
+            auto iter = _queued.begin();
+            Job *job = iter->second;
+            _queued.erase(iter);
+
+            // start it
+            launch(job);
+        }
+    }
+
+    /**
+     *  Process all activity on the filedescriptors, without blocking
+     */
+    void drain()
+    {
+        // construct an event loop based on the file descriptors of all handlers
+        Loop loop(_descriptors);
+
+        // run the event loop, but do not block
+        while (loop.step(std::bind(&Pool::dispatch, this, _1, _2), false)) { /* keep iterating */ }
+
+        // jobs that completed make room for jobs that are queued
+        admit();
+    }
+
+    /**
+     *  Call the callbacks of the jobs that are ready
+     */
+    void deliver()
+    {
+        // check the jobs that are ready
+        while (!_done.empty())
+        {
+            // get the first job that is ready
+            Job *job = _done.front();
+            _done.pop_front();
+
+            // look it up
+            auto iter = _jobs.find(job);
+
+            // skip if it is no longer in the pool
+            if (iter == _jobs.end()) continue;
+
+            // the job and the callback
+            Php::Value phpjob = iter->second;
+            Php::Value callback = _callbacks[job];
+
+            // remove it from the pool (before the call, because the callback
+            // may add jobs or throw an exception)
+            remove(job);
+
+            // notify the user
+            callback(phpjob);
+        }
     }
 
     /**
@@ -49,25 +346,29 @@ private:
      */
     Php::Value extract()
     {
-        // iterate over the jobs
-        for (auto iter : _jobs)
+        // check the jobs that are ready
+        while (!_ready.empty())
         {
-            // get access to the job
-            Job *job = iter.first;
-            
-            // move on if the job is not ready
-            if (!job->ready()) continue;
-            
+            // get the first job that is ready
+            Job *job = _ready.front();
+            _ready.pop_front();
+
+            // look it up
+            auto iter = _jobs.find(job);
+
+            // skip if it is no longer in the pool
+            if (iter == _jobs.end()) continue;
+
             // this job is ready, store the php variable
-            Php::Value result = iter.second;
-            
-            // remove it from the map
-            _jobs.erase(job);
-            
+            Php::Value result = iter->second;
+
+            // remove it from the pool
+            remove(job);
+
             // done
             return result;
         }
-        
+
         // no job was ready
         return nullptr;
     }
@@ -78,62 +379,120 @@ public:
      *  Constructor
      */
     Pool() = default;
-    
+
+    /**
+     *  The php constructor
+     *  @param  params
+     */
+    void __construct(Php::Parameters &params)
+    {
+        // the options are optional
+        if (params.size() == 0) return;
+
+        // the options
+        Php::Value options = params[0];
+
+        // the max number of running jobs
+        if (options.contains("maxrunning")) _maxrunning = std::max(options["maxrunning"].numericValue(), (int64_t)0);
+    }
+
     /**
      *  Destructor
      */
-    virtual ~Pool() = default;
-    
+    virtual ~Pool()
+    {
+        // the jobs that are still in the pool should no longer report to us
+        for (auto &iter : _jobs) iter.first->completion(nullptr);
+
+        // stop watching the handlers
+        _handlers.clear();
+    }
+
     /**
-     *  Add a job to the pool
-     *  @param  params
+     *  Add a job to the pool, it is started right away, unless the max number
+     *  of running jobs is reached
+     *  @param  params      the job, the optional priority and the optional
+     *                      callback (the callback may also be the second parameter)
      */
     void add(Php::Parameters &params)
     {
         // get the job as php variable
         Php::Value phpjob = params[0];
-        
+
         // must be a yothalot job
         if (!phpjob.instanceOf("Yothalot\\Job")) throw Php::Exception("Not a valid job supplied");
-        
+
         // convert to the job wrapper
         auto *wrapper = (Job *)phpjob.implementation();
-        
-        // make sure the job is started
-        wrapper->start();
-        
+
+        // the job might already be in the pool
+        if (_jobs.find(wrapper) != _jobs.end()) return;
+
+        // the second parameter is either the callback or the priority
+        bool second = params.size() > 1 && params[1].isCallable();
+
+        // the priority of the job
+        int64_t priority = params.size() > 1 && !second ? params[1].numericValue() : 0;
+
+        // the callback
+        if (second) _callbacks[wrapper] = params[1];
+        else if (params.size() > 2 && !params[2].isNull()) _callbacks[wrapper] = params[2];
+
         // add the jobimpl class
         _jobs.insert(std::make_pair(wrapper, phpjob));
-        
-        // add the tcp handler
-        _handlers.insert(wrapper->handler());
+
+        // the job has to wait for its turn
+        _queued.emplace(priority, wrapper);
+
+        // start it if there is room
+        admit();
     }
-    
+
     /**
      *  Expose a job that is ready
      *  @return Php::Value
      */
     Php::Value fetch()
     {
-        // skip if there are no more tcp handlers listed
-        if (_handlers.empty()) return nullptr;
-        
-        // we are going to create one big event loop with the file descriptors of all connections
-        Descriptors descriptors;
-    
-        // check all connections
-        for (const auto &handler : _handlers) descriptors.add(handler->descriptors());
-
-        // construct an event loop based on all these file descriptors
-        Loop loop(descriptors);
-        
-        // run the event loop, but do not block
-        while (loop.step(std::bind(&Pool::process, this, _1, _2), false)) { /* keep iterating */ }
-        
+        // process what is available
+        drain();
+
+        // call the callbacks
+        deliver();
+
         // extract a job
         return extract();
     }
-    
+
+    /**
+     *  Filedescriptor that becomes readable when there is activity for one
+     *  of the jobs in the pool, so that the pool can be monitored by an
+     *  external event loop, which should call process() when it is readable
+     *  @return Php::Value
+     */
+    Php::Value fd() const
+    {
+        // the epoll instance that monitors the descriptors of all handlers
+        return _descriptors.epoll();
+    }
+
+    /**
+     *  Process the activity on the filedescriptors without blocking, the
+     *  jobs that are ready can then be retrieved with fetch()
+     *  @return Php::Value  number of jobs that are ready
+     */
+    Php::Value process()
+    {
+        // process what is available
+        drain();
+
+        // call the callbacks
+        deliver();
+
+        // count the jobs that are ready and still in the pool
+        return (int64_t)std::count_if(_ready.begin(), _ready.end(), [this](Job *job) { return _jobs.count(job) > 0; });
+    }
+
     /**
      *  Size of the job
      *  @return Php::Value
@@ -142,7 +501,7 @@ public:
     {
         return (int)_jobs.size();
     }
-    
+
     /**
      *  Size of the job
      *  @return unsigned
@@ -151,42 +510,67 @@ public:
     {
         return _jobs.size();
     }
-    
+
     /**
      *  Wait for the first job that is ready, and return that job
+     *  @param  params      optional number of seconds to wait
+     *  @return Php::Value  the job, or null when the timeout expired
+     */
+    Php::Value wait(Php::Parameters &params)
+    {
+        // pass on with the moment at which we stop waiting
+        return next(params.size() > 0 ? Deadline(params[0].floatValue()) : Deadline());
+    }
+
+    /**
+     *  Iterate over the jobs in the order in which they complete
      *  @return Php::Value
      */
-    Php::Value wait()
+    Php::Value completed()
+    {
+        // create the object to iterate over
+        return Php::Object("Yothalot\\Completed", new Completed(Php::Value(this), this));
+    }
+
+    /**
+     *  Wait for the first job that is ready, and return that job
+     *  @param  deadline    moment at which we stop waiting
+     *  @return Php::Value  the job, or null when the deadline passed or when
+     *                      the pool is empty
+     */
+    Php::Value next(const Deadline &deadline)
     {
-        // skip if there are no more connections listed
-        if (_handlers.empty()) return nullptr;
-        
-        // we are going to create one big event loop with the file descriptors of all connections
-        Descriptors descriptors;
-    
-        // check all tcp handlers
-        for (const auto &handler : _handlers) descriptors.add(handler->descriptors());
-        
-        // construct an event loop based on all these file descriptors
-        Loop loop(descriptors);
+        // construct an event loop based on the file descriptors of all handlers
+        Loop loop(_descriptors);
 
         // keep looping as long as we have jobs
         while (!_jobs.empty())
         {
+            // jobs that completed make room for jobs that are queued
+            admit();
+
+            // call the callbacks
+            deliver();
+
             // get a job that is ready
             auto job = extract();
-            
+
             // we're done if we indeed has a ready job
             if (!job.isNull()) return job;
-            
-            // let's take one more step in the event loop (this is not so efficient,
-            // better would be to run the event loop until we're sure that a job is ready)
-            loop.step(std::bind(&Pool::process, this, _1, _2));
+
+            // the callbacks may have emptied the pool
+            if (_jobs.empty()) return nullptr;
+
+            // if there is nothing to wait for, no job is going to become ready
+            if (!_descriptors) return nullptr;
+
+            // we give up when the deadline has passed
+            if (deadline.expired()) return nullptr;
+
+            // let's take one more step in the event loop
+            loop.step(std::bind(&Pool::dispatch, this, _1, _2), deadline);
         }
-        
-        // there are no more active jobs
-        _handlers.clear();
-        
+
         // impossible to return a job
         return nullptr;
     }
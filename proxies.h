@@ -0,0 +1,158 @@
+/**
+ *  Proxies.h
+ *
+ *  The PHP Yothalot\Reducer, Yothalot\Writer and Yothalot\Values objects that
+ *  are passed to the methods of the algorithm. Instead of allocating new PHP
+ *  objects for each call, one object of each kind is created, and it is
+ *  rebound to the underlying C++ object before every call.
+ *
+ *  @copyright 2016 Copernica BV
+ */
+
+/**
+ *  Include guard
+ */
+#pragma once
+
+/**
+ *  Dependencies
+ */
+#include <phpcpp.h>
+#include <yothalot.h>
+#include "reducer.h"
+#include "writer.h"
+#include "values.h"
+
+/**
+ *  Class definition
+ */
+class Proxies
+{
+private:
+    /**
+     *  The PHP reducer object, and its implementation
+     *  @var Php::Value
+     *  @var Reducer
+     */
+    Php::Value _reducer;
+    Reducer *_reducerimpl = nullptr;
+
+    /**
+     *  The PHP writer object, and its implementation
+     *  @var Php::Value
+     *  @var Writer
+     */
+    Php::Value _writer;
+    Writer *_writerimpl = nullptr;
+
+    /**
+     *  The PHP values object, and its implementation
+     *  @var Php::Value
+     *  @var Values
+     */
+    Php::Value _values;
+    Values *_valuesimpl = nullptr;
+
+    /**
+     *  The number of PHP objects that were created in this process
+     *  @return size_t
+     */
+    static size_t &counter()
+    {
+        // the counter is shared by all proxies
+        static size_t counter = 0;
+
+        // expose it
+        return counter;
+    }
+
+    /**
+     *  Create a PHP object
+     *  @param  classname   name of the PHP class
+     *  @param  impl        the implementation
+     *  @return Php::Value
+     */
+    static Php::Value create(const char *classname, Php::Base *impl)
+    {
+        // one more object was created
+        ++counter();
+
+        // create the object
+        return Php::Object(classname, impl);
+    }
+
+public:
+    /**
+     *  Constructor
+     */
+    Proxies() = default;
+
+    /**
+     *  No copying
+     *  @param  that
+     */
+    Proxies(const Proxies &that) = delete;
+
+    /**
+     *  Destructor
+     */
+    virtual ~Proxies() = default;
+
+    /**
+     *  The number of PHP proxy objects that were created by this process,
+     *  this can be used to check that the number of allocations does not
+     *  grow with the number of keys
+     *  @return size_t
+     */
+    static size_t allocations()
+    {
+        return counter();
+    }
+
+    /**
+     *  Get the PHP reducer object that forwards to a reducer
+     *  @param  reducer
+     *  @return Php::Value
+     */
+    const Php::Value &reducer(Yothalot::Reducer &reducer)
+    {
+        // create the object on first use, rebind it otherwise
+        if (_reducerimpl == nullptr) _reducer = create("Yothalot\\Reducer", _reducerimpl = new Reducer(reducer));
+        else _reducerimpl->rebind(reducer);
+
+        // expose the object
+        return _reducer;
+    }
+
+    /**
+     *  Get the PHP writer object that forwards to a writer
+     *  @param  writer
+     *  @return Php::Value
+     */
+    const Php::Value &writer(Yothalot::Writer &writer)
+    {
+        // create the object on first use, rebind it otherwise
+        if (_writerimpl == nullptr) _writer = create("Yothalot\\Writer", _writerimpl = new Writer(writer));
+        else _writerimpl->rebind(writer);
+
+        // expose the object
+        return _writer;
+    }
+
+    /**
+     *  Get the PHP values object that iterates over values
+     *  @param  values      the values passed to the reducer, or buffered values
+     *  @return Php::Value
+     */
+    template <typename VALUES>
+    const Php::Value &values(const VALUES &values)
+    {
+        // create the object on first use, rebind it otherwise
+        if (_valuesimpl == nullptr) _values = create("Yothalot\\Values", _valuesimpl = new Values(values));
+        else _valuesimpl->rebind(values);
+
+        // expose the object
+        return _values;
+    }
+};
+
@@ -18,11 +18,18 @@
 #include <phpcpp.h>
 #include <amqpcpp.h>
 #include <copernica/nosql.h>
+#include <set>
+#include "json/msgpack.h"
 #include "json/object.h"
 #include "descriptors.h"
 #include "loop.h"
 #include "tcphandler.h"
 
+/**
+ *  Forward declarations
+ */
+class ReplyQueue;
+
 /**
  *  Class definition
  */
@@ -61,6 +68,38 @@ private:
      */
     std::unique_ptr<AMQP::TcpConnection> _rabbit;
 
+    /**
+     *  The queue to which the results of the jobs are published (this is
+     *  created by the first job that needs it)
+     *  @var std::shared_ptr<ReplyQueue>
+     */
+    std::shared_ptr<ReplyQueue> _replies;
+
+    /**
+     *  The channel on which all jobs are published (in confirm mode)
+     *  @var std::unique_ptr<AMQP::TcpChannel>
+     */
+    std::unique_ptr<AMQP::TcpChannel> _publisher;
+
+    /**
+     *  Delivery tag of the last message that was published on the channel
+     *  @var uint64_t
+     */
+    uint64_t _tag = 0;
+
+    /**
+     *  Delivery tags of the messages that were not yet confirmed
+     *  @var std::set
+     */
+    std::set<uint64_t> _outstanding;
+
+    /**
+     *  Number of messages that were confirmed and rejected since the last flush
+     *  @var size_t
+     */
+    size_t _confirmed = 0;
+    size_t _nacked = 0;
+
     /**
      *  The error that was discovered
      *  @var std::string
@@ -79,6 +118,12 @@ private:
      */
     bool _feedback = false;
 
+    /**
+     *  Should jobs be published as MessagePack instead of JSON?
+     *  @var bool
+     */
+    bool _msgpack = false;
+
     /**
      *  Called when connection is in error state
      *  @param  connection      The connection that entered the error state
@@ -90,7 +135,7 @@ private:
         _error.assign(message);
 
         // reset the connection
-        _rabbit = nullptr;
+        disconnect();
     }
 
     /**
@@ -109,10 +154,36 @@ private:
      */
     virtual void onClosed(AMQP::TcpConnection *connection) override
     {
+        // reset connection
+        disconnect();
+    }
+
+    /**
+     *  Forget the connection and the channel that publishes on it
+     */
+    void disconnect()
+    {
+        // the messages that were not yet confirmed are never going to be
+        abandon();
+
+        // the channel is bound to the connection, so it goes first
+        _publisher = nullptr;
+
         // reset connection
         _rabbit = nullptr;
     }
 
+    /**
+     *  Count the messages that are still waiting for a confirmation as nacked,
+     *  because the channel that they were published on is gone
+     */
+    void abandon()
+    {
+        // the messages that were not yet confirmed are lost
+        _nacked += _outstanding.size();
+        _outstanding.clear();
+    }
+
     /**
      *  Monitor a filedescriptor for readability or writability
      *  @param  connection  The TCP connection object that is reporting
@@ -125,6 +196,70 @@ private:
         _descriptors.add(fd, flags);
     }
 
+    /**
+     *  Settle one or more outstanding messages
+     *  @param  tag         delivery tag
+     *  @param  multiple    also settle all earlier messages?
+     *  @param  counter     counter to increment
+     */
+    void settle(uint64_t tag, bool multiple, size_t &counter)
+    {
+        // all messages up to and including the tag, or only the tag itself
+        auto begin = multiple ? _outstanding.begin() : _outstanding.find(tag);
+        auto end = _outstanding.upper_bound(tag);
+
+        // leap out if the tag is unknown
+        if (begin == _outstanding.end()) return;
+
+        // count and forget the messages
+        for (auto iter = begin; iter != end; ++iter) ++counter;
+        _outstanding.erase(begin, end);
+    }
+
+    /**
+     *  Called when the publish channel fails
+     *  @param  message
+     */
+    void onPublishError(const char *message)
+    {
+        // the messages that were not yet confirmed are lost
+        abandon();
+
+        // report the error
+        Php::warning << message << std::flush;
+    }
+
+    /**
+     *  Get the channel to publish on
+     *  @return AMQP::TcpChannel
+     */
+    AMQP::TcpChannel *publisher()
+    {
+        // the existing channel can be used if it did not fail
+        if (_publisher && _publisher->usable()) return _publisher.get();
+
+        // messages that are still outstanding on the old channel are lost, their
+        // tags would otherwise collide with the tags on the new channel
+        abandon();
+
+        // create a new channel
+        _publisher.reset(new AMQP::TcpChannel(_rabbit.get()));
+
+        // delivery tags start counting again on a new channel
+        _tag = 0;
+
+        // report errors
+        _publisher->onError(std::bind(&Rabbit::onPublishError, this, _1));
+
+        // put the channel in confirm mode
+        _publisher->confirmSelect()
+            .onAck([this](uint64_t tag, bool multiple) { settle(tag, multiple, _confirmed); })
+            .onNack([this](uint64_t tag, bool multiple, bool) { settle(tag, multiple, _nacked); });
+
+        // done
+        return _publisher.get();
+    }
+
     /**
      *  Create the AMQP connection
      *  @return bool
@@ -213,6 +348,11 @@ public:
         // nothing to do for us when we're not connected
         if (!_rabbit) return;
 
+        // the reply queue and publish channel are no longer needed (the queue
+        // is removed by the server when the connection is closed)
+        _replies = nullptr;
+        _publisher = nullptr;
+
         // close the connection
         _rabbit->close();
 
@@ -288,11 +428,25 @@ public:
         // create the connection to the RabbitMQ server
         if (!connect()) return false;
 
-        // create temporary channel, so that possible errors do not affect the connection
-        AMQP::TcpChannel channel(_rabbit.get());
+        // publish the json on the long-lived channel
+        if (!_msgpack && !publisher()->publish(_exchange, queue, json.toString())) return false;
+
+        // or encode it as MessagePack, the content type tells the master what it is
+        if (_msgpack)
+        {
+            // encode the job, the envelope only refers to this buffer, so it must outlive it
+            std::string encoded = JSON::MsgPack::encode(json);
+
+            // create the envelope
+            AMQP::Envelope envelope(encoded.data(), encoded.size());
+            envelope.setContentType(JSON::MsgPack::contentType());
+
+            // publish it
+            if (!publisher()->publish(_exchange, queue, envelope)) return false;
+        }
 
-        // publish the json
-        channel.publish(_exchange, queue, json.toString());
+        // the message is now waiting for a confirmation
+        _outstanding.insert(++_tag);
 
         // done
         return true;
@@ -300,21 +454,40 @@ public:
 
     /**
      *  Flush the connection
-     *  This runs the event loop until everything has been sent
+     *  This runs the event loop until all published messages are confirmed
+     *  or rejected by RabbitMQ
+     *  @param  confirmed   number of messages confirmed since the previous flush
+     *  @param  nacked      number of messages rejected since the previous flush
      */
-    void flush()
+    void flush(size_t &confirmed, size_t &nacked)
     {
-        // flush is pointless without a connection
-        if (!_rabbit) return;
+        // without a connection nothing could have been published
+        if (_rabbit)
+        {
+            // create an event loop with just these file descriptors
+            Loop loop(_descriptors);
 
-        // create an event loop with just these file descriptors
-        Loop loop(_descriptors);
+            // step through the loop until all messages are settled
+            while (!_outstanding.empty() && loop.step(_rabbit.get())) { /* keep going */ }
+        }
 
-        // step through the loop as long as we have active channels
-        // we're working in such a way that all the channels drop away the second
-        // they're no longer needed, meaning that we've pushed/retrieved everything
-        // from rabbitmq the second we have no channels left
-        while (_rabbit->channels() > 0) loop.step(_rabbit.get());
+        // expose the counters
+        confirmed = _confirmed;
+        nacked = _nacked;
+
+        // start counting again
+        _confirmed = _nacked = 0;
+    }
+
+    /**
+     *  The queue to which results are published, this is shared by all jobs
+     *  that are started via this connection
+     *  @return std::shared_ptr<ReplyQueue>
+     */
+    std::shared_ptr<ReplyQueue> &replies()
+    {
+        // expose member
+        return _replies;
     }
 
     /**
@@ -340,4 +513,14 @@ public:
         // expose member
         return _feedback;
     }
+
+    /**
+     *  Publish jobs as MessagePack instead of JSON
+     *  @param  value
+     */
+    void msgpack(bool value)
+    {
+        // store member
+        _msgpack = value;
+    }
 };
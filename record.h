@@ -4,7 +4,7 @@
  *  Class that wraps a log record for use in Yothalot
  * 
  *  @author Emiel Bruijntjes <emiel.bruijntjes@copernica.com>
- *  @copyright 2015 Copernica BV
+ *  @copyright 2015 - 2016 Copernica BV
  */
 
 /**
@@ -33,7 +33,66 @@ private:
      */
     std::shared_ptr<Yothalot::Record> _record;
 
+    /**
+     *  Is the record borrowed from the task?
+     *  @var bool
+     */
+    bool _borrowed = false;
+
 public:
+    /**
+     *  Helper class that wraps a borrowed record in a PHP object, and that
+     *  makes the PHP object copy the record when it is still referenced
+     *  after the call (also when the call ended with an exception)
+     */
+    class Borrowed
+    {
+    private:
+        /**
+         *  The implementation of the PHP object
+         *  @var Record
+         */
+        Record *_record;
+
+        /**
+         *  The PHP object
+         *  @var Php::Object
+         */
+        Php::Object _object;
+
+    public:
+        /**
+         *  Constructor
+         *  @param  record      the record that is borrowed
+         */
+        Borrowed(const Yothalot::Record &record) :
+            _record(new Record(record)), _object("Yothalot\\Record", _record) {}
+
+        /**
+         *  No copying
+         *  @param  that
+         */
+        Borrowed(const Borrowed &that) = delete;
+
+        /**
+         *  Destructor
+         */
+        virtual ~Borrowed()
+        {
+            // if someone kept a reference to the record, it needs its own copy
+            if (_object.refcount() > 1) _record->release();
+        }
+
+        /**
+         *  The PHP object
+         *  @return Php::Object
+         */
+        const Php::Object &object() const
+        {
+            return _object;
+        }
+    };
+
     /**
      *  Constructor
      *  @param  record
@@ -41,11 +100,35 @@ public:
     Record(const std::shared_ptr<Yothalot::Record> &record) : 
         _record(record) {}
 
+    /**
+     *  Constructor for a record that is borrowed from the task, the record
+     *  is not copied, so release() must be called before the task destructs
+     *  the record when the PHP object is still in use by then
+     *  @param  record
+     */
+    Record(const Yothalot::Record &record) :
+        _record(const_cast<Yothalot::Record *>(&record), [](Yothalot::Record *) {}), _borrowed(true) {}
+
     /**
      *  Destructor
      */
     virtual ~Record() {}
 
+    /**
+     *  Stop borrowing the record, and make a private copy of it instead
+     */
+    void release()
+    {
+        // only relevant for borrowed records
+        if (!_borrowed) return;
+
+        // copy the record
+        _record = std::make_shared<Yothalot::Record>(*_record);
+
+        // we have our own record now
+        _borrowed = false;
+    }
+
     /**
      *  The record identifier
      *  @return Php::Value
@@ -19,10 +19,11 @@ class RecordIterator : public Php::Iterator
 {
 private:
     /**
-     *  The record that is being iterated
+     *  The record that is being iterated (this is a reference to the pointer
+     *  in the Record object, because a borrowed record may be replaced by a copy)
      *  @var std::shared_ptr<Yothalot::Record> _record;
      */
-    std::shared_ptr<Yothalot::Record> _record;
+    const std::shared_ptr<Yothalot::Record> &_record;
 
     /**
      *  The current index
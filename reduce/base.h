@@ -0,0 +1,262 @@
+/**
+ *  Base.h
+ *
+ *  Base class for the built-in reducers, that reduce the values of a key
+ *  entirely in C++, without calling into PHP userspace
+ *
+ *  @copyright 2016 Copernica BV
+ */
+
+/**
+ *  Include guard
+ */
+#pragma once
+
+/**
+ *  Dependencies
+ */
+#include <phpcpp.h>
+#include <yothalot.h>
+#include <stdlib.h>
+#include <string>
+#include <memory>
+#include "../tuple.h"
+
+/**
+ *  Set up namespace
+ */
+namespace Reduce {
+
+/**
+ *  Class definition
+ */
+class Base : public Php::Base
+{
+protected:
+    /**
+     *  Helper class for constructing the tuples that are emitted
+     */
+    class Result : public Yothalot::Tuple
+    {
+    public:
+        /**
+         *  Constructor
+         */
+        Result() = default;
+
+        /**
+         *  Destructor
+         */
+        virtual ~Result() = default;
+    };
+
+public:
+    /**
+     *  The partial result for a single key, while the values that are emitted
+     *  by a mapper are being aggregated
+     */
+    class Partial
+    {
+    public:
+        /**
+         *  Destructor
+         */
+        virtual ~Partial() = default;
+
+        /**
+         *  Merge a value into the partial result
+         *  @param  value
+         */
+        virtual void merge(const Yothalot::Tuple &value) = 0;
+
+        /**
+         *  Estimate of the number of bytes in memory used by the partial result
+         *  @return size_t
+         */
+        virtual size_t bytes() const = 0;
+
+        /**
+         *  The partial result, this is only called after at least one merge
+         *  @return Yothalot::Tuple
+         */
+        virtual const Yothalot::Tuple &result() = 0;
+    };
+
+private:
+    /**
+     *  Partial result that is a tuple that is replaced by aggregate() for
+     *  every value, this is used by reducers with small partial results
+     */
+    class Merged : public Partial
+    {
+    private:
+        /**
+         *  The reducer that merges the values
+         *  @var Base
+         */
+        Base &_operation;
+
+        /**
+         *  The partial result so far
+         *  @var std::unique_ptr<Tuple::Copy>
+         */
+        std::unique_ptr<Tuple::Copy> _value;
+
+    public:
+        /**
+         *  Constructor
+         *  @param  operation
+         */
+        Merged(Base &operation) : _operation(operation) {}
+
+        /**
+         *  Destructor
+         */
+        virtual ~Merged() = default;
+
+        /**
+         *  Merge a value into the partial result
+         *  @param  value
+         */
+        virtual void merge(const Yothalot::Tuple &value) override
+        {
+            // let the reducer replace the tuple
+            _operation.aggregate(_value, value);
+        }
+
+        /**
+         *  Estimate of the number of bytes in memory used by the partial result
+         *  @return size_t
+         */
+        virtual size_t bytes() const override
+        {
+            // the size of the tuple
+            return _value ? _value->bytes() : 0;
+        }
+
+        /**
+         *  The partial result
+         *  @return Yothalot::Tuple
+         */
+        virtual const Yothalot::Tuple &result() override
+        {
+            // expose the tuple
+            return *_value;
+        }
+    };
+
+public:
+    /**
+     *  Constructor
+     */
+    Base() = default;
+
+    /**
+     *  Destructor
+     */
+    virtual ~Base() = default;
+
+    /**
+     *  Get the numeric value of a field in a tuple (strings are converted
+     *  the same way as PHP converts numeric strings to integers)
+     *  @param  tuple
+     *  @param  index
+     *  @return int64_t
+     */
+    static int64_t number(const Yothalot::Tuple &tuple, size_t index)
+    {
+        // numbers can be returned right away
+        if (tuple.isNumber(index)) return tuple.number(index);
+
+        // null values count as zero
+        if (tuple.isNull(index)) return 0;
+
+        // parse the string
+        return strtoll(tuple.string(index).data(), nullptr, 10);
+    }
+
+    /**
+     *  Compare two tuples field by field, where null values come before
+     *  numbers, and numbers come before strings
+     *  @param  a
+     *  @param  b
+     *  @return int         negative, zero or positive, just like strcmp()
+     */
+    static int compare(const Yothalot::Tuple &a, const Yothalot::Tuple &b)
+    {
+        // compare all fields that both tuples have
+        for (size_t i = 0; i < a.fields() && i < b.fields(); ++i)
+        {
+            // the type-order of the fields
+            int ta = a.isNull(i) ? 0 : a.isNumber(i) ? 1 : 2;
+            int tb = b.isNull(i) ? 0 : b.isNumber(i) ? 1 : 2;
+
+            // different types?
+            if (ta != tb) return ta - tb;
+
+            // null values are equal
+            if (ta == 0) continue;
+
+            // compare numbers
+            if (ta == 1 && a.number(i) != b.number(i)) return a.number(i) < b.number(i) ? -1 : 1;
+
+            // numbers are equal
+            if (ta == 1) continue;
+
+            // compare strings
+            int result = a.string(i).compare(b.string(i));
+
+            // strings are different?
+            if (result != 0) return result;
+        }
+
+        // the tuple with fewer fields comes first
+        return (int)a.fields() - (int)b.fields();
+    }
+
+    /**
+     *  Reduce the values that belong to a key
+     *  @param  values      the values to reduce
+     *  @param  writer      the writer to which the reduced value is emitted
+     */
+    virtual void reduce(const Yothalot::Values &values, Yothalot::Writer &writer) = 0;
+
+    /**
+     *  Create the partial result for a key, this is used to aggregate the
+     *  values that are emitted by a mapper before they are shuffled. By default
+     *  the partial result is a tuple that is updated with aggregate()
+     *  @return Partial
+     */
+    virtual Partial *partial()
+    {
+        // construct a tuple-based partial result
+        return new Merged(*this);
+    }
+
+    /**
+     *  Merge a single value into a partial result, reducers that override
+     *  partial() do not have to implement this
+     *  @param  partial     the partial result so far (empty for the first value)
+     *  @param  value       the value to merge into it
+     */
+    virtual void aggregate(std::unique_ptr<Tuple::Copy> &, const Yothalot::Tuple &) {}
+
+    /**
+     *  Convert the reduced value into the value that is passed to the write()
+     *  method, most reducers emit values that do not have to be converted
+     *  @param  value       the reduced value
+     *  @param  buffer      tuple that can be filled with the converted value
+     *  @return Yothalot::Tuple
+     */
+    virtual const Yothalot::Tuple &finalize(const Yothalot::Tuple &value, Tuple::Copy &) const
+    {
+        // no conversion needed
+        return value;
+    }
+};
+
+/**
+ *  End of namespace
+ */
+}
+
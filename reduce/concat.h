@@ -0,0 +1,214 @@
+/**
+ *  Concat.h
+ *
+ *  Built-in reducer that concatenates all values into a single string,
+ *  separated by an optional separator. The fields of values with multiple
+ *  fields are concatenated too.
+ *
+ *  @copyright 2016 Copernica BV
+ */
+
+/**
+ *  Include guard
+ */
+#pragma once
+
+/**
+ *  Dependencies
+ */
+#include "base.h"
+
+/**
+ *  Set up namespace
+ */
+namespace Reduce {
+
+/**
+ *  Class definition
+ */
+class Concat : public Base
+{
+private:
+    /**
+     *  The separator
+     *  @var std::string
+     */
+    std::string _separator;
+
+    /**
+     *  Append all fields of a value to a buffer
+     *  @param  buffer
+     *  @param  value
+     */
+    static void append(std::string &buffer, const Yothalot::Tuple &value)
+    {
+        // add all fields
+        for (size_t i = 0; i < value.fields(); ++i)
+        {
+            // null values are empty
+            if (value.isNull(i)) continue;
+
+            // add the number or string
+            if (value.isNumber(i)) buffer.append(std::to_string(value.number(i)));
+            else buffer.append(value.string(i));
+        }
+    }
+
+    /**
+     *  Partial result that appends the values to a string
+     */
+    class Text : public Partial
+    {
+    private:
+        /**
+         *  The separator
+         *  @var std::string
+         */
+        const std::string &_separator;
+
+        /**
+         *  The concatenated values so far
+         *  @var std::string
+         */
+        std::string _buffer;
+
+        /**
+         *  Is the next value the first one?
+         *  @var bool
+         */
+        bool _first = true;
+
+        /**
+         *  The tuple that is exposed as result
+         *  @var std::unique_ptr<Tuple::Copy>
+         */
+        std::unique_ptr<Tuple::Copy> _result;
+
+    public:
+        /**
+         *  Constructor
+         *  @param  separator
+         */
+        Text(const std::string &separator) : _separator(separator) {}
+
+        /**
+         *  Destructor
+         */
+        virtual ~Text() = default;
+
+        /**
+         *  Merge a value into the partial result
+         *  @param  value
+         */
+        virtual void merge(const Yothalot::Tuple &value) override
+        {
+            // add the separator if this is not the first value
+            if (!_first) _buffer.append(_separator);
+
+            // the next value is no longer the first
+            _first = false;
+
+            // add all fields
+            append(_buffer, value);
+        }
+
+        /**
+         *  Estimate of the number of bytes in memory used by the partial result
+         *  @return size_t
+         */
+        virtual size_t bytes() const override
+        {
+            // the string is the only thing that grows
+            return sizeof(Text) + _buffer.capacity();
+        }
+
+        /**
+         *  The partial result
+         *  @return Yothalot::Tuple
+         */
+        virtual const Yothalot::Tuple &result() override
+        {
+            // construct the tuple only once, now that all values are in
+            _result.reset(new Tuple::Copy());
+
+            // add the string
+            _result->add(_buffer);
+
+            // expose the tuple
+            return *_result;
+        }
+    };
+
+public:
+    /**
+     *  Destructor
+     */
+    virtual ~Concat() = default;
+
+    /**
+     *  The PHP constructor
+     *  @param  params
+     */
+    void __construct(Php::Parameters &params)
+    {
+        // store the optional separator
+        if (params.size() > 0) _separator = params[0].stringValue();
+    }
+
+    /**
+     *  Reduce the values that belong to a key
+     *  @param  values      the values to reduce
+     *  @param  writer      the writer to which the reduced value is emitted
+     */
+    virtual void reduce(const Yothalot::Values &values, Yothalot::Writer &writer) override
+    {
+        // the concatenated string
+        std::string buffer;
+
+        // is this the first value?
+        bool first = true;
+
+        // iterate over the values
+        for (Yothalot::Values iter(values); iter; ++iter)
+        {
+            // the current value
+            const Yothalot::Tuple &value = *iter;
+
+            // add the separator if this is not the first value
+            if (!first) buffer.append(_separator);
+
+            // the next value is no longer the first
+            first = false;
+
+            // add all fields
+            append(buffer, value);
+        }
+
+        // construct the result
+        Result result;
+
+        // add the string
+        result.add(buffer);
+
+        // emit the result
+        writer.emit(result);
+    }
+
+    /**
+     *  Create the partial result for a key, the partial result keeps a string
+     *  to which all values are appended, so that the values do not have to be
+     *  copied over and over again
+     *  @return Partial
+     */
+    virtual Partial *partial() override
+    {
+        // construct the string-based partial result
+        return new Text(_separator);
+    }
+};
+
+/**
+ *  End of namespace
+ */
+}
+
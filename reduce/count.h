@@ -0,0 +1,142 @@
+/**
+ *  Count.h
+ *
+ *  Built-in reducer that counts the number of values. Because reduce() may
+ *  be called more than once for the same key, the counts that are emitted
+ *  are marked as such, so that they are added up (instead of counted as a
+ *  single value) when they are reduced again. The mark is removed before
+ *  the count is passed to the write() method. The partial counts of a Count
+ *  aggregator are only marked when they are reduced by a Count reducer too,
+ *  any other reducer gets plain numbers (that should be added up).
+ *
+ *  @copyright 2016 Copernica BV
+ */
+
+/**
+ *  Include guard
+ */
+#pragma once
+
+/**
+ *  Dependencies
+ */
+#include "base.h"
+
+/**
+ *  Set up namespace
+ */
+namespace Reduce {
+
+/**
+ *  Class definition
+ */
+class Count : public Base
+{
+private:
+    /**
+     *  The first field of a count that was emitted by this reducer
+     *  @return std::string
+     */
+    static const std::string &marker()
+    {
+        // a string that does not show up in regular values
+        static const std::string marker("\0yothalot-count", 15);
+
+        // expose it
+        return marker;
+    }
+
+    /**
+     *  The number of values that a value stands for: a count that was emitted
+     *  before stands for that many values, other values count as one
+     *  @param  value
+     *  @return int64_t
+     */
+    static int64_t count(const Yothalot::Tuple &value)
+    {
+        // is this a count that was emitted before?
+        if (value.fields() == 2 && value.isString(0) && value.isNumber(1) && value.string(0) == marker()) return value.number(1);
+
+        // a regular value
+        return 1;
+    }
+
+    /**
+     *  Fill a tuple with a marked count
+     *  @param  tuple
+     *  @param  count
+     */
+    static void fill(Yothalot::Tuple &tuple, int64_t count)
+    {
+        // add the marker and the count
+        tuple.add(marker());
+        tuple.add(count);
+    }
+
+public:
+    /**
+     *  Destructor
+     */
+    virtual ~Count() = default;
+
+    /**
+     *  Reduce the values that belong to a key
+     *  @param  values      the values to reduce
+     *  @param  writer      the writer to which the reduced value is emitted
+     */
+    virtual void reduce(const Yothalot::Values &values, Yothalot::Writer &writer) override
+    {
+        // the number of values
+        int64_t total = 0;
+
+        // iterate over the values, counts from an earlier pass are added up
+        for (Yothalot::Values iter(values); iter; ++iter) total += count(*iter);
+
+        // construct the result
+        Result result;
+
+        // add the count
+        fill(result, total);
+
+        // emit the result
+        writer.emit(result);
+    }
+
+    /**
+     *  Merge a single value into a partial result, the partial result is the
+     *  number of values seen so far
+     *  @param  partial     the partial result so far (empty for the first value)
+     *  @param  value       the value to merge into it
+     */
+    virtual void aggregate(std::unique_ptr<Tuple::Copy> &partial, const Yothalot::Tuple &value) override
+    {
+        // the new count
+        int64_t total = (partial ? count(*partial) : 0) + count(value);
+
+        // construct the new partial result
+        partial.reset(new Tuple::Copy());
+
+        // add the count
+        fill(*partial, total);
+    }
+
+    /**
+     *  Remove the marker from the count that is passed to the write() method
+     *  @param  value       the reduced value
+     *  @param  buffer      tuple that is filled with the plain count
+     *  @return Yothalot::Tuple
+     */
+    virtual const Yothalot::Tuple &finalize(const Yothalot::Tuple &value, Tuple::Copy &buffer) const override
+    {
+        // keys with a single value might not have been reduced at all
+        buffer.add(count(value));
+
+        // expose the plain count
+        return buffer;
+    }
+};
+
+/**
+ *  End of namespace
+ */
+}
@@ -0,0 +1,65 @@
+/**
+ *  First.h
+ *
+ *  Built-in reducer that emits the first value, and ignores all others
+ *
+ *  @copyright 2016 Copernica BV
+ */
+
+/**
+ *  Include guard
+ */
+#pragma once
+
+/**
+ *  Dependencies
+ */
+#include "base.h"
+
+/**
+ *  Set up namespace
+ */
+namespace Reduce {
+
+/**
+ *  Class definition
+ */
+class First : public Base
+{
+public:
+    /**
+     *  Destructor
+     */
+    virtual ~First() = default;
+
+    /**
+     *  Reduce the values that belong to a key
+     *  @param  values      the values to reduce
+     *  @param  writer      the writer to which the reduced value is emitted
+     */
+    virtual void reduce(const Yothalot::Values &values, Yothalot::Writer &writer) override
+    {
+        // the values to iterate over
+        Yothalot::Values iter(values);
+
+        // emit the first value, if there is one
+        if (iter) writer.emit(*iter);
+    }
+
+    /**
+     *  Merge a single value into a partial result
+     *  @param  partial     the partial result so far (empty for the first value)
+     *  @param  value       the value to merge into it
+     */
+    virtual void aggregate(std::unique_ptr<Tuple::Copy> &partial, const Yothalot::Tuple &value) override
+    {
+        // only the first value is kept
+        if (!partial) partial.reset(new Tuple::Copy(value));
+    }
+};
+
+/**
+ *  End of namespace
+ */
+}
+
@@ -0,0 +1,81 @@
+/**
+ *  Max.h
+ *
+ *  Built-in reducer that emits the highest value. Numbers are compared
+ *  numerically, strings byte by byte, and values with multiple fields
+ *  are compared field by field.
+ *
+ *  @copyright 2016 Copernica BV
+ */
+
+/**
+ *  Include guard
+ */
+#pragma once
+
+/**
+ *  Dependencies
+ */
+#include <memory>
+#include "base.h"
+
+/**
+ *  Set up namespace
+ */
+namespace Reduce {
+
+/**
+ *  Class definition
+ */
+class Max : public Base
+{
+public:
+    /**
+     *  Destructor
+     */
+    virtual ~Max() = default;
+
+    /**
+     *  Reduce the values that belong to a key
+     *  @param  values      the values to reduce
+     *  @param  writer      the writer to which the reduced value is emitted
+     */
+    virtual void reduce(const Yothalot::Values &values, Yothalot::Writer &writer) override
+    {
+        // the highest value found so far
+        std::unique_ptr<Tuple::Copy> result;
+
+        // iterate over the values
+        for (Yothalot::Values iter(values); iter; ++iter)
+        {
+            // skip if the value is not higher
+            if (result && compare(*iter, *result) <= 0) continue;
+
+            // remember the value
+            result.reset(new Tuple::Copy(*iter));
+        }
+
+        // emit the result
+        if (result) writer.emit(*result);
+    }
+
+    /**
+     *  Merge a single value into a partial result
+     *  @param  partial     the partial result so far (empty for the first value)
+     *  @param  value       the value to merge into it
+     */
+    virtual void aggregate(std::unique_ptr<Tuple::Copy> &partial, const Yothalot::Tuple &value) override
+    {
+        // skip if the value is not higher
+        if (partial && compare(value, *partial) <= 0) return;
+
+        // remember the value
+        partial.reset(new Tuple::Copy(value));
+    }
+};
+
+/**
+ *  End of namespace
+ */
+}
+
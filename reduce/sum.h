@@ -0,0 +1,104 @@
+/**
+ *  Sum.h
+ *
+ *  Built-in reducer that adds up all values. Values with multiple fields
+ *  are added up field by field.
+ *
+ *  @copyright 2016 Copernica BV
+ */
+
+/**
+ *  Include guard
+ */
+#pragma once
+
+/**
+ *  Dependencies
+ */
+#include <vector>
+#include <algorithm>
+#include "base.h"
+
+/**
+ *  Set up namespace
+ */
+namespace Reduce {
+
+/**
+ *  Class definition
+ */
+class Sum : public Base
+{
+public:
+    /**
+     *  Destructor
+     */
+    virtual ~Sum() = default;
+
+    /**
+     *  Reduce the values that belong to a key
+     *  @param  values      the values to reduce
+     *  @param  writer      the writer to which the reduced value is emitted
+     */
+    virtual void reduce(const Yothalot::Values &values, Yothalot::Writer &writer) override
+    {
+        // the totals per field
+        std::vector<int64_t> totals;
+
+        // iterate over the values
+        for (Yothalot::Values iter(values); iter; ++iter)
+        {
+            // the current value
+            const Yothalot::Tuple &value = *iter;
+
+            // make sure we have room for all fields
+            if (totals.size() < value.fields()) totals.resize(value.fields(), 0);
+
+            // add up all fields
+            for (size_t i = 0; i < value.fields(); ++i) totals[i] += number(value, i);
+        }
+
+        // construct the result
+        Result result;
+
+        // add all the totals
+        for (auto total : totals) result.add(total);
+
+        // emit the result
+        writer.emit(result);
+    }
+
+    /**
+     *  Merge a single value into a partial result
+     *  @param  partial     the partial result so far (empty for the first value)
+     *  @param  value       the value to merge into it
+     */
+    virtual void aggregate(std::unique_ptr<Tuple::Copy> &partial, const Yothalot::Tuple &value) override
+    {
+        // the new partial result
+        std::unique_ptr<Tuple::Copy> result(new Tuple::Copy());
+
+        // the number of fields in the result
+        size_t fields = partial ? std::max(partial->fields(), value.fields()) : value.fields();
+
+        // add up all fields
+        for (size_t i = 0; i < fields; ++i)
+        {
+            // fields that are missing in one of the tuples count as zero
+            int64_t a = partial && i < partial->fields() ? number(*partial, i) : 0;
+            int64_t b = i < value.fields() ? number(value, i) : 0;
+
+            // add the total
+            result->add(a + b);
+        }
+
+        // store the new partial result
+        partial = std::move(result);
+    }
+};
+
+/**
+ *  End of namespace
+ */
+}
+
@@ -26,22 +26,33 @@ class Reducer : public Php::Base
 {
 private:
     /**
-     *  The underlying reducer by reference
+     *  The underlying reducer
      *  @var Yothalot::Reducer
      */
-    Yothalot::Reducer &_reducer;
+    Yothalot::Reducer *_reducer;
 
 public:
     /**
      *  Constructor
      */
-    Reducer(Yothalot::Reducer &reducer) : _reducer(reducer) {};
+    Reducer(Yothalot::Reducer &reducer) : _reducer(&reducer) {};
 
     /**
      *  Destructor
      */
     virtual ~Reducer() {};
 
+    /**
+     *  Let the object forward to a different reducer, so that the same PHP
+     *  object can be reused for the next call
+     *  @param  reducer
+     */
+    void rebind(Yothalot::Reducer &reducer)
+    {
+        // store the new reducer
+        _reducer = &reducer;
+    }
+
     /**
      *  Get the size of the log file in bytes
      */
@@ -52,6 +63,6 @@ public:
         Php::Value value = params[1];
 
         // pass the key and value to the actual reducer
-        _reducer.emit(Tuple::Yothalot(key), Tuple::Yothalot(value));
+        _reducer->emit(Tuple::Yothalot(key), Tuple::Yothalot(value));
     }
 };
@@ -0,0 +1,252 @@
+/**
+ *  ReplyQueue.h
+ *
+ *  The queue to which the results of all jobs that are started via the same
+ *  RabbitMQ connection are published. The queue is declared once, and the
+ *  results are passed to the job that they belong to based on the correlation
+ *  ID. The correlation ID is stored in the job JSON, and the master publishes
+ *  the result with that ID as correlation-id property. If the property is
+ *  missing, the "correlation" field of the result JSON is used instead. A
+ *  result without any correlation ID is passed to the only job that is
+ *  waiting, if there is exactly one.
+ *
+ *  @copyright 2016 Copernica BV
+ */
+
+/**
+ *  Include guard
+ */
+#pragma once
+
+/**
+ *  Dependencies
+ */
+#include <amqpcpp.h>
+#include <string>
+#include <unordered_map>
+#include <stdexcept>
+#include "json/object.h"
+#include "json/msgpack.h"
+#include "loop.h"
+
+/**
+ *  Class definition
+ */
+class ReplyQueue
+{
+public:
+    /**
+     *  Interface for objects that receive a reply
+     */
+    class Receiver
+    {
+    public:
+        /**
+         *  Destructor
+         */
+        virtual ~Receiver() = default;
+
+        /**
+         *  Called when the reply comes in
+         *  @param  result      the parsed result
+         */
+        virtual void onReply(const JSON::Object &result) = 0;
+
+        /**
+         *  Called when the queue failed, and no reply is going to come
+         *  @param  message
+         */
+        virtual void onFailure(const char *message) = 0;
+    };
+
+private:
+    /**
+     *  The channel on which the queue is consumed
+     *  @var AMQP::TcpChannel
+     */
+    AMQP::TcpChannel _channel;
+
+    /**
+     *  Name of the queue
+     *  @var std::string
+     */
+    std::string _name;
+
+    /**
+     *  The error that was reported (empty if the queue is valid)
+     *  @var std::string
+     */
+    std::string _error;
+
+    /**
+     *  The objects that are waiting for a reply, by correlation ID
+     *  @var std::unordered_map
+     */
+    std::unordered_map<std::string,Receiver*> _receivers;
+
+    /**
+     *  Counter to generate the correlation IDs
+     *  @var uint64_t
+     */
+    uint64_t _counter = 0;
+
+
+    /**
+     *  Method that is called when the queue has been declared
+     *  @param  name
+     */
+    void onDeclared(const std::string &name)
+    {
+        // store the name
+        _name = name;
+
+        // start consuming, there is no need to ack the messages, because the queue is exclusive
+        _channel.consume(_name, AMQP::noack).onReceived(std::bind(&ReplyQueue::onReceived, this, _1, _2));
+    }
+
+    /**
+     *  Method that is called when a reply comes in
+     *  @param  message
+     */
+    void onReceived(const AMQP::Message &message, uint64_t)
+    {
+        // parse the result (it is either JSON or MessagePack)
+        JSON::Object result(JSON::MsgPack::parse(message.body(), message.bodySize()));
+
+        // the correlation ID should be in the message properties, but we also check the result itself
+        std::string id = message.hasCorrelationID() ? message.correlationID() : correlation(result);
+
+        // find the receiver
+        auto iter = _receivers.find(id);
+
+        // a master that does not pass on the ID can still be used when only one job is waiting
+        if (id.empty() && _receivers.size() == 1) iter = _receivers.begin();
+
+        // ignore replies for jobs that are no longer there
+        if (iter == _receivers.end()) return;
+
+        // the receiver is no longer waiting
+        auto *receiver = iter->second;
+        _receivers.erase(iter);
+
+        // pass on the reply
+        receiver->onReply(result);
+    }
+
+    /**
+     *  Channel errors
+     *  @param  message
+     */
+    void onError(const char *message)
+    {
+        // remember the error
+        _error = message;
+
+        // no reply is going to come for the receivers, they are moved out
+        // of the map first, because they may unsubscribe from the callback
+        auto receivers = std::move(_receivers);
+        _receivers.clear();
+
+        // tell them
+        for (auto &iter : receivers) iter.second->onFailure(message);
+    }
+
+    /**
+     *  Get the correlation ID from the result JSON
+     *  @param  result
+     *  @return std::string
+     */
+    static std::string correlation(const JSON::Object &result)
+    {
+        // look up the ID
+        const char *id = result.c_str("correlation");
+
+        // expose the ID
+        return id ? id : "";
+    }
+
+public:
+    /**
+     *  Constructor, this declares the queue
+     *  @param  rabbit      the RabbitMQ connection
+     *  @throws std::runtime_error
+     */
+    ReplyQueue(Rabbit *rabbit) : _channel(rabbit->connection())
+    {
+        // set up error handler
+        _channel.onError(std::bind(&ReplyQueue::onError, this, _1));
+
+        // declare the queue, it is removed when the connection is closed
+        _channel.declareQueue(AMQP::autodelete | AMQP::exclusive).onSuccess(std::bind(&ReplyQueue::onDeclared, this, _1));
+
+        // construct an event loop for the connection
+        Loop loop(rabbit->descriptors());
+
+        // run the event loop, because we need to know the name
+        while (_name.empty() && _error.empty())
+        {
+            // leap out when the event loop fails (for example because the connection is lost)
+            if (!loop.step(rabbit->connection())) _error = "connection lost while declaring the reply queue";
+        }
+
+        // check for errors
+        if (!_error.empty()) throw std::runtime_error(_error);
+    }
+
+    /**
+     *  No copying
+     *  @param  that
+     */
+    ReplyQueue(const ReplyQueue &that) = delete;
+
+    /**
+     *  Destructor
+     */
+    virtual ~ReplyQueue() = default;
+
+    /**
+     *  Is the queue still valid?
+     *  @return bool
+     */
+    bool valid() const
+    {
+        return _error.empty();
+    }
+
+    /**
+     *  Name of the queue
+     *  @return std::string
+     */
+    const std::string &name() const
+    {
+        return _name;
+    }
+
+    /**
+     *  Start waiting for a reply
+     *  @param  receiver    object that is notified when the reply comes in
+     *  @return std::string the correlation ID
+     */
+    std::string subscribe(Receiver *receiver)
+    {
+        // generate an ID
+        std::string id = std::to_string(++_counter);
+
+        // store the receiver
+        _receivers[id] = receiver;
+
+        // done
+        return id;
+    }
+
+    /**
+     *  Stop waiting for a reply
+     *  @param  id          the correlation ID
+     */
+    void unsubscribe(const std::string &id)
+    {
+        // forget the receiver
+        _receivers.erase(id);
+    }
+};
+
@@ -0,0 +1,449 @@
+/**
+ *  ReplySocket.h
+ *
+ *  The socket on which the results of all jobs that are started by this
+ *  process come in (when the results are not published via RabbitMQ). There
+ *  is just one such socket per process, and the results are passed to the
+ *  job that they belong to based on the "correlation" field of the result.
+ *
+ *  @author Emiel Bruijntjes <emiel.bruijntjes@copernica.com>
+ *  @author David van Erkelens <david.vanerkelens@copernica.com>
+ *
+ *  @copyright 2016 Copernica BV
+ */
+
+/**
+ *  Include guard
+ */
+#pragma once
+
+/**
+ *  Dependencies
+ */
+#include <copernica/dns.h>
+#include <unordered_map>
+#include <errno.h>
+#include <unistd.h>
+#include <memory>
+#include "json/object.h"
+#include "json/msgpack.h"
+
+/**
+ *  Class definition
+ */
+class ReplySocket : public TcpHandler
+{
+public:
+    /**
+     *  Interface for objects that receive a reply
+     */
+    class Receiver
+    {
+    public:
+        /**
+         *  Destructor
+         */
+        virtual ~Receiver() = default;
+
+        /**
+         *  Called when the reply comes in
+         *  @param  result      the parsed result
+         */
+        virtual void onReply(const JSON::Object &result) = 0;
+    };
+
+private:
+    /**
+     *  The socket file descriptor
+     *  @var int
+     */
+    int _fd;
+
+    /**
+     *  The accepted connections, and the data that was received on them so far
+     *  @var std::unordered_map
+     */
+    std::unordered_map<int,std::string> _connections;
+    
+    /**
+     *  All file descriptors
+     *  @var Descriptors
+     */
+    Descriptors _descriptors;
+
+    /**
+     *  The name
+     *  @var std::string
+     * 
+     *  @todo remove this
+     */
+    mutable std::string _name;
+
+    /**
+     *  The objects that are waiting for a reply, by correlation ID
+     *  @var std::unordered_map
+     */
+    std::unordered_map<std::string,Receiver*> _receivers;
+
+    /**
+     *  Counter to generate the correlation IDs
+     *  @var uint64_t
+     */
+    uint64_t _counter = 0;
+
+    /**
+     *  The process that created the socket (a forked child process must not
+     *  use the socket of its parent, it would steal the results of the parent)
+     *  @var pid_t
+     */
+    pid_t _pid = getpid();
+
+    /**
+     *  The IP address we're listening on
+     *  @var Copernica::Dns::IpAddress
+     */
+    mutable Copernica::Dns::IpAddress _ip;
+
+    /**
+     *  The port we're listening on
+     *  @var int
+     */
+    mutable int _port = 0;
+
+    /**
+     *  Accept all pending connections on the listening socket
+     */
+    void accept()
+    {
+        // there may be more than one connection waiting
+        while (true)
+        {
+            // store data about the connecting client
+            struct sockaddr_in client_address;
+            
+            // store the struct length
+            socklen_t addr_length = sizeof(client_address);
+            
+            // create a new socket, it is non-blocking so that a slow sender
+            // does not stall the other jobs
+            int newsocket = accept4(_fd, (struct sockaddr *)&client_address, &addr_length, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            
+            // leap out if there are no more connections
+            if (newsocket < 0) return;
+            
+            // create a buffer for the connection
+            _connections[newsocket];
+            
+            // we want to be notified when data comes in
+            _descriptors.add(newsocket, AMQP::readable);
+        }
+    }
+
+    /**
+     *  Read the data that is available on an accepted connection
+     *  @param  fd      the connection
+     *  @param  buffer  the data received so far
+     */
+    void read(int fd, std::string &buffer)
+    {
+        // read until the socket would block
+        while (true)
+        {
+            // construct a temporary buffer
+            char tempbuf[4096];
+            
+            // read data into the buffer
+            auto bytes = ::read(fd, tempbuf, 4096);
+            
+            // append to the full buffer
+            if (bytes > 0) { buffer.append(tempbuf, bytes); continue; }
+            
+            // nothing left to read for now, we wait for the next event
+            if (bytes < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return;
+            
+            // try again if we were interrupted
+            if (bytes < 0 && errno == EINTR) continue;
+            
+            // end of file (or an error), the result is complete
+            return finish(fd);
+        }
+    }
+
+    /**
+     *  Called when the sender closed a connection
+     *  @param  fd      the connection
+     */
+    void finish(int fd)
+    {
+        // move the result out of the map
+        std::string buffer = std::move(_connections[fd]);
+        
+        // the connection is no longer needed
+        _descriptors.remove(fd);
+        _connections.erase(fd);
+        close(fd);
+        
+        // parse the result (it is either JSON or MessagePack)
+        JSON::Object result(JSON::MsgPack::parse(buffer.data(), buffer.size()));
+        
+        // the ID of the job that the result belongs to
+        std::string id = correlation(result);
+        
+        // find the receiver
+        auto iter = _receivers.find(id);
+        
+        // a master that does not pass on the correlation ID can still be
+        // used when there is just one job waiting (but a result with an ID
+        // that is no longer known belongs to a job that is gone)
+        if (id.empty() && _receivers.size() == 1) iter = _receivers.begin();
+        
+        // ignore replies for jobs that are no longer there
+        if (iter == _receivers.end()) return;
+        
+        // the receiver is no longer waiting
+        auto *receiver = iter->second;
+        _receivers.erase(iter);
+        
+        // pass on the reply
+        receiver->onReply(result);
+    }
+
+    /**
+     *  Get the correlation ID from the result JSON
+     *  @param  result
+     *  @return std::string
+     */
+    static std::string correlation(const JSON::Object &result)
+    {
+        // look up the ID
+        const char *id = result.c_str("correlation");
+
+        // expose the ID
+        return id ? id : "";
+    }
+
+public:
+    /**
+     *  Constructor
+     *  @throws std::runtime_error
+     */
+    ReplySocket() : _fd(socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0))
+    {
+        // was the socket created?
+        if (_fd < 0) throw std::runtime_error("failed to open socket");
+        
+        // set address settings
+        struct sockaddr_in address;
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = INADDR_ANY;
+        address.sin_port = 0;
+        
+        // bind the socket to the file descriptor
+        if (bind(_fd, (struct sockaddr *)&address, sizeof(address)) < 0)
+        {
+            // the destructor is not called, so we close the socket ourselves
+            close(_fd);
+            
+            // something went wrong...
+            throw std::runtime_error("failed to bind socket");
+        }
+        
+        // listen to the socket, with a backlog that is big enough for large pools
+        if (listen(_fd, SOMAXCONN) < 0)
+        {
+            // the destructor is not called, so we close the socket ourselves
+            close(_fd);
+            
+            // something went wrong...
+            throw std::runtime_error("failed to listen on socket");
+        }
+        
+        // add the file descriptors
+        _descriptors.add(_fd, AMQP::readable);
+    }
+
+    /**
+     *  No copying
+     *  @param  that
+     */
+    ReplySocket(const ReplySocket &that) = delete;
+    
+    /**
+     *  Destructor
+     */
+    virtual ~ReplySocket()
+    {
+        // close the connections that were not finished
+        for (auto &iter : _connections) close(iter.first);
+        
+        // close the socket
+        close(_fd);
+    }
+
+    /**
+     *  The socket that is shared by all jobs in this process, it is created
+     *  on first use, and again after the process was forked
+     *  @return std::shared_ptr<ReplySocket>
+     *  @throws std::runtime_error
+     */
+    static const std::shared_ptr<ReplySocket> &instance()
+    {
+        // the one and only socket
+        static std::shared_ptr<ReplySocket> socket;
+
+        // create it if we did not have it yet, or if it belongs to the parent
+        // process (the jobs of the parent that were copied into this process
+        // keep the old object alive, closing it here does not affect the parent)
+        if (!socket || socket->_pid != getpid()) socket = std::make_shared<ReplySocket>();
+
+        // expose it
+        return socket;
+    }
+
+    /**
+     *  The file descriptors that are monitored by this handler
+     *  @return Descriptors
+     */
+    virtual const Descriptors &descriptors() const override
+    {
+        // expose the member
+        return _descriptors;
+    }
+
+    /**
+     *  Method that is called when a filedescriptor becomes active
+     *  @param  fd      the filedescriptor that is active
+     *  @param  flags   type of activity (readable or writalble)
+     */
+    virtual void process(int fd, int) override
+    {
+        // is this the listening socket?
+        if (fd == _fd) return accept();
+        
+        // find the connection
+        auto iter = _connections.find(fd);
+        
+        // ignore if this is not even our socket
+        if (iter == _connections.end()) return;
+        
+        // read the data that is available
+        read(fd, iter->second);
+    }
+
+    /**
+     *  Start waiting for a reply
+     *  @param  receiver    object that is notified when the reply comes in
+     *  @return std::string the correlation ID
+     */
+    std::string subscribe(Receiver *receiver)
+    {
+        // generate an ID, it includes the process ID, so that it is unique
+        // even when parent and child processes use the same counter values
+        std::string id = std::to_string(_pid) + "-" + std::to_string(++_counter);
+
+        // store the receiver
+        _receivers[id] = receiver;
+
+        // done
+        return id;
+    }
+
+    /**
+     *  Stop waiting for a reply
+     *  @param  id          the correlation ID
+     */
+    void unsubscribe(const std::string &id)
+    {
+        // forget the receiver
+        _receivers.erase(id);
+    }
+
+    /**
+     *  Return the IP address we're listening on
+     *  @return Copernica::Dns::IpAddress
+     */
+    const Copernica::Dns::IpAddress &ip() const
+    {
+        // is the ip already set?
+        if (_ip != Copernica::Dns::IpAddress("0.0.0.0")) return _ip;
+
+        // create a socket
+        int s = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+        
+        // was the socket creation succesful?
+        if (s >= 0)
+        {
+            // address of a google DNS server
+            Copernica::Dns::IpAddress google("8.8.8.8");
+            
+            // structure to initialize
+            struct sockaddr_in address;
+            
+            // fill the members
+            address.sin_family = AF_INET;
+            address.sin_port = htons(53);
+            
+            // copy address
+            memcpy(&address.sin_addr, (const struct in_addr *)google, sizeof(struct in_addr));
+
+            // connect to this address
+            if (connect(s, (struct sockaddr *)&address, sizeof(struct sockaddr_in)) == 0)
+            {
+                // connection succeeded, find out ip
+                struct sockaddr_in address;
+                socklen_t size = sizeof(address);
+                
+                // get sock name
+                if (getsockname(s, (struct sockaddr *)&address, &size) == 0)
+                {
+                    // fetch ip address
+                    _ip = Copernica::Dns::IpAddress(address.sin_addr);
+                }
+            }
+
+            // close socket
+            close(s);
+        }
+
+        // return 
+        return _ip;
+    }
+
+    /**
+     *  Fetch the port we're listening on
+     *  @return int
+     */
+    int port() const
+    {
+        // is the port already set?
+        if (_port > 0) return _port;
+        
+        // fetch the port we're listening on
+        struct sockaddr_in address;
+        socklen_t len = sizeof(address);
+        getsockname(_fd, (struct sockaddr *)&address, &len);
+
+        // save port
+        _port = (int)ntohs(address.sin_port);
+
+        // return
+        return _port;
+    }
+    
+    /**
+     *  Address of the socket
+     *  @todo this should be changed into an "address" property
+     */
+    const std::string &name() const
+    {
+        // did we already construct the name?
+        if (_name.length() > 0) return _name;
+        
+        // we don't have the name yet, construct it
+        _name = ip().str() + ":" + std::to_string(port());
+        
+        // return name
+        return _name;
+    }
+};
+
@@ -12,6 +12,8 @@
  *  Dependencies
  */
 #include "cache.h"
+#include "blobs.h"
+#include "bundle.h"
 
 /**
  *  Include guard
@@ -55,6 +57,27 @@ private:
     Yothalot::Target _target;
     
     
+    /**
+     *  Load the input data that was stored in the cache
+     *  @param  reference   Array with the name of the stored object and the fallback file
+     *  @return Php::Value  unserialized input data
+     *  @throws std::runtime_error
+     */
+    static Php::Value resolve(const Php::Value &reference)
+    {
+        // load the data, from the local copy, from the cache or from the fallback file
+        std::string data = Blobs::load(reference.get("blob").stringValue(), reference.get("fallback").stringValue());
+
+        // unserialize it, just like inline data
+        Php::Value unserialized(Php::call("unserialize", Php::call("base64_decode", Php::Value(data.data(), data.size()))));
+
+        // must be an array
+        if (!unserialized.isArray()) throw std::runtime_error("failed to unserialize stored input data");
+
+        // done
+        return unserialized;
+    }
+
     /**
      *  Initialize the object
      *  @return Php::Value  unserialized input data
@@ -77,10 +100,16 @@ private:
         // must be an array
         if (!unserialized.isArray()) throw std::runtime_error("failed to unserialize input data");
 
+        // big algorithms are not passed inline, but stored in the cache
+        if (unserialized.contains("blob")) unserialized = resolve(unserialized);
+
         // store the includes and the actual object
         Php::Value includes = unserialized[0];
         Php::Value object = unserialized[1];
 
+        // the include files may have been shipped with the job
+        if (includes.isArray() && includes.contains("bundle")) includes = Bundle::unpack(includes);
+
         // the return value of the includes method could be a single string
         if (includes.isString())
         {
@@ -171,6 +200,18 @@ public:
         return _data.size() - (_rest - _data.data());
     }
     
+    /**
+     *  Was the object revived from a certain buffer?
+     *  @param  buffer
+     *  @param  size
+     *  @return bool
+     */
+    bool equals(const char *buffer, size_t size) const
+    {
+        // compare the buffers
+        return _data.size() == size && memcmp(_data.data(), buffer, size) == 0;
+    }
+
     /**
      *  Expose target object
      *  @return Yothalot::Target
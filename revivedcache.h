@@ -0,0 +1,139 @@
+/**
+ *  RevivedCache.h
+ *
+ *  Cache of revived algorithm objects, used by worker processes that run
+ *  many tasks, so that the include files are not loaded and the algorithm
+ *  is not unserialized over and over again when subsequent tasks belong
+ *  to the same algorithm.
+ *
+ *  @copyright 2016 Copernica BV
+ */
+
+/**
+ *  Include guard
+ */
+#pragma once
+
+/**
+ *  Dependencies
+ */
+#include <functional>
+#include <map>
+#include "revived.h"
+#include "wrapper.h"
+
+/**
+ *  Class definition
+ */
+class RevivedCache
+{
+private:
+    /**
+     *  Max number of algorithms that are kept in the cache
+     *  @var size_t
+     */
+    static const size_t maxsize = 16;
+
+    /**
+     *  Class with a revived object and the wrapper around it
+     */
+    class Entry
+    {
+    public:
+        /**
+         *  The revived object
+         *  @var std::shared_ptr<Revived>
+         */
+        std::shared_ptr<Revived> revived;
+
+        /**
+         *  Wrapper around the algorithm, created on first use
+         *  @var std::unique_ptr<Wrapper>
+         */
+        std::unique_ptr<Wrapper> wrapper;
+
+        /**
+         *  Constructor
+         *  @param  buffer
+         *  @param  size
+         */
+        Entry(const char *buffer, size_t size) : revived(std::make_shared<Revived>(buffer, size)) {}
+    };
+
+    /**
+     *  All the cached algorithms, indexed by the hash of the serialized data
+     *  @var std::multimap
+     */
+    std::multimap<size_t,Entry> _entries;
+
+
+public:
+    /**
+     *  Constructor
+     */
+    RevivedCache() = default;
+
+    /**
+     *  No copying
+     *  @param  that
+     */
+    RevivedCache(const RevivedCache &that) = delete;
+
+    /**
+     *  Destructor
+     */
+    virtual ~RevivedCache() = default;
+
+    /**
+     *  Revive the header of the input, or use an object that was revived
+     *  earlier from exactly the same header
+     *  @param  buffer      the serialized data
+     *  @param  size        size of the buffer
+     *  @return std::shared_ptr<Revived>
+     *  @throws std::runtime_error
+     */
+    const std::shared_ptr<Revived> &revive(const char *buffer, size_t size)
+    {
+        // calculate the hash
+        size_t hash = std::hash<std::string>()(std::string(buffer, size));
+
+        // look for an object with the same serialized data
+        auto range = _entries.equal_range(hash);
+        for (auto iter = range.first; iter != range.second; ++iter)
+        {
+            // check if this object was revived from the same data
+            if (iter->second.revived->equals(buffer, size)) return iter->second.revived;
+        }
+
+        // we do not want the cache to grow forever
+        if (_entries.size() >= maxsize) _entries.clear();
+
+        // revive a new object (this throws when the data is invalid)
+        return _entries.emplace(hash, Entry(buffer, size))->second.revived;
+    }
+
+    /**
+     *  Get the wrapper around a revived algorithm object
+     *  @param  revived     object that was returned by revive()
+     *  @return Wrapper
+     */
+    Wrapper &wrapper(const std::shared_ptr<Revived> &revived)
+    {
+        // look up the entry
+        for (auto &entry : _entries)
+        {
+            // is this the one?
+            if (entry.second.revived != revived) continue;
+
+            // create the wrapper if we did not have it yet
+            if (!entry.second.wrapper) entry.second.wrapper.reset(new Wrapper(revived->object()));
+
+            // expose the wrapper
+            return *entry.second.wrapper;
+        }
+
+        // this is impossible, but we do not want to crash
+        throw std::runtime_error("algorithm object is not cached");
+    }
+};
+
@@ -4,6 +4,15 @@
  *  Input that is read from stdin, and that contains the data for the
  *  task, and the original serialized object
  *
+ *  Only the header (the serialized object, up to the "\n\n" separator) is
+ *  kept in memory. The payload that follows it is either mapped into memory
+ *  (when stdin is a regular file) or read with large read() calls (when stdin
+ *  is a pipe), and it is handed over to the task in bounded chunks that end
+ *  on a newline, so that memory usage does not grow with the input size.
+ *
+ *  When a worker process runs multiple tasks, the input is framed: each task
+ *  only reads a limited number of bytes from the filedescriptor.
+ *
  *  @author Emiel Bruijntjes <emiel.bruijntjes@copernica.com>
  *  @copyright 2015 - 2016 Copernica BV
  */
@@ -16,7 +25,15 @@
 /**
  *  Dependencies
  */
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <stdexcept>
+#include <string>
 #include "revived.h"
+#include "revivedcache.h"
 
 /**
  *  Class definition
@@ -24,35 +41,325 @@
 class Stdin
 {
 private:
+    /**
+     *  Size of the chunks that are passed to the task, and the size of
+     *  the read() calls when stdin is not a regular file
+     *  @var size_t
+     */
+    static const size_t chunksize = 4 * 1024 * 1024;
+
+    /**
+     *  The filedescriptor to read from
+     *  @var int
+     */
+    int _fd;
+
+    /**
+     *  Number of bytes that may still be read from the filedescriptor
+     *  @var size_t
+     */
+    size_t _remaining;
+
+    /**
+     *  The memory mapped input (only when stdin is a regular file)
+     *  @var char
+     */
+    char *_mapped = nullptr;
+
+    /**
+     *  Size of the mapped input
+     *  @var size_t
+     */
+    size_t _mapsize = 0;
+
+    /**
+     *  Buffer with data that has been read, but that was not yet processed
+     *  (only used when stdin is not a regular file)
+     *  @var std::string
+     */
+    std::string _buffer;
+
+    /**
+     *  Offset in the buffer or mapped input where the unprocessed data starts
+     *  @var size_t
+     */
+    size_t _offset = 0;
+
+    /**
+     *  Did we reach the end of the input?
+     *  @var bool
+     */
+    bool _eof = false;
+
     /**
      *  The revived data
      *  @var Revived
      */
-    std::unique_ptr<Revived> _data;
-    
+    std::shared_ptr<Revived> _data;
+
+
+    /**
+     *  Try to map the input into memory
+     *  @return bool
+     */
+    bool map()
+    {
+        // framed input can not be mapped
+        if (_remaining != std::string::npos) return false;
+
+        // find out what sort of file we're reading from
+        struct stat info;
+
+        // only regular, non-empty, files can be mapped
+        if (fstat(_fd, &info) != 0 || !S_ISREG(info.st_mode) || info.st_size == 0) return false;
+
+        // map the entire file
+        void *result = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, _fd, 0);
+
+        // check for failure
+        if (result == MAP_FAILED) return false;
+
+        // the data is going to be read from front to back
+        madvise(result, info.st_size, MADV_SEQUENTIAL);
+
+        // store the mapping
+        _mapped = (char *)result;
+        _mapsize = info.st_size;
+
+        // we have all the data
+        _eof = true;
+
+        // done
+        return true;
+    }
+
+    /**
+     *  Read the next block of data into the buffer
+     *  @return bool        was anything read?
+     *  @throws std::runtime_error
+     */
+    bool read()
+    {
+        // nothing to read after end-of-file
+        if (_eof) return false;
+
+        // the number of bytes that we're going to read
+        size_t blocksize = std::min((size_t)chunksize, _remaining);
+
+        // if we are not allowed to read anything more, we're at the end
+        if (blocksize == 0) { _eof = true; return false; }
+
+        // get rid of the data that was already processed
+        if (_offset > 0) _buffer.erase(0, _offset);
+
+        // the processed data is gone
+        _offset = 0;
+
+        // current size of the buffer
+        size_t size = _buffer.size();
+
+        // make room for the next block
+        _buffer.resize(size + blocksize);
+
+        // number of bytes read so far
+        size_t total = 0;
+
+        // pipes return small blocks, so we keep reading until the block is full
+        while (total < blocksize)
+        {
+            // read data into the buffer
+            auto bytes = ::read(_fd, &_buffer[size + total], blocksize - total);
+
+            // try again on signals
+            if (bytes < 0 && errno == EINTR) continue;
+
+            // a failure is not the end of the input, the task would otherwise process truncated input
+            if (bytes < 0) { _buffer.resize(size + total); throw std::runtime_error(std::string("failed to read input: ") + strerror(errno)); }
+
+            // are we at the end?
+            if (bytes == 0) { _eof = true; break; }
+
+            // update the counter
+            total += bytes;
+        }
+
+        // shrink buffer to the data that was actually read
+        _buffer.resize(size + total);
+
+        // update the number of bytes that may still be read
+        if (_remaining != std::string::npos) _remaining -= total;
+
+        // report whether data was read
+        return total > 0;
+    }
+
+    /**
+     *  Release the mapped input, and skip the rest of the framed input, so
+     *  that the next frame can be read
+     */
+    void cleanup()
+    {
+        // unmap the memory
+        if (_mapped) munmap(_mapped, _mapsize);
+
+        // the memory is gone
+        _mapped = nullptr;
+
+        // only framed input has to be skipped, other input is not used after this task
+        if (_remaining == std::string::npos) return;
+
+        // this is also called from the destructor, so read errors must not bubble up
+        try
+        {
+            // framed input must be read completely, so that the next frame can be read
+            while (read()) _offset = _buffer.size();
+        }
+        catch (const std::runtime_error &)
+        {
+            // there is nothing more that we can read
+            _eof = true;
+        }
+    }
+
+    /**
+     *  Pointer to the unprocessed data
+     *  @return const char *
+     */
+    const char *buffer() const
+    {
+        return (_mapped ? _mapped : _buffer.data()) + _offset;
+    }
+
+    /**
+     *  Number of bytes of unprocessed data that is available
+     *  @return size_t
+     */
+    size_t available() const
+    {
+        return (_mapped ? _mapsize : _buffer.size()) - _offset;
+    }
+
+    /**
+     *  Find the size of the next chunk, which holds at most chunksize bytes
+     *  (unless there is a line that does not fit), and that ends on a newline
+     *  @return size_t      size of the chunk, or 0 if more data has to be read
+     */
+    size_t chunk() const
+    {
+        // the window in which we're looking for a newline
+        size_t window = std::min(available(), (size_t)chunksize);
+
+        // look for the last newline in the window
+        auto *newline = (const char *)memrchr(buffer(), '\n', window);
+
+        // found it?
+        if (newline != nullptr) return newline - buffer() + 1;
+
+        // if there is no more data to come, we just pass everything
+        if (_eof) return available();
+
+        // if the window was not full, more data must be read first
+        if (window < chunksize) return 0;
+
+        // the line is longer than a chunk, look for its end further on
+        newline = (const char *)memchr(buffer() + window, '\n', available() - window);
+
+        // found it? otherwise more data must be read
+        return newline ? newline - buffer() + 1 : 0;
+    }
+
+    /**
+     *  Mark a number of bytes as processed
+     *  @param  size
+     */
+    void consume(size_t size)
+    {
+        // when reading from a buffer there is nothing special to do
+        if (_mapped == nullptr) { _offset += size; return; }
+
+        // the page size, because we can only release full pages
+        static const size_t pagesize = sysconf(_SC_PAGESIZE);
+
+        // start of the pages that were completely processed before, and the new start
+        size_t from = _offset / pagesize * pagesize;
+        size_t to = (_offset + size) / pagesize * pagesize;
+
+        // the processed pages are no longer needed
+        if (to > from) madvise(_mapped + from, to - from, MADV_DONTNEED);
+
+        // update the offset
+        _offset += size;
+    }
+
 public:
     /**
-     *  Constructor that reads input and turns it into a string
+     *  Constructor that reads the header of the input
+     *  @param  fd          the filedescriptor to read from
+     *  @param  limit       max number of bytes to read (for framed input)
+     *  @param  cache       optional cache with earlier revived objects
+     *  @throws std::runtime_error
      */
-    Stdin()
+    Stdin(int fd = STDIN_FILENO, size_t limit = std::string::npos, RevivedCache *cache = nullptr) : 
+        _fd(fd), _remaining(limit)
     {
-        // see http://stackoverflow.com/questions/201992/how-to-read-until-eof-from-cin-in-c
-        // don't skip the whitespace while reading
-        std::cin >> std::noskipws;
+        // the destructor is not called when the constructor fails, so we
+        // must make sure ourselves that the rest of the frame is skipped
+        try
+        {
+            // mapping the input is the fastest, but only possible for regular files,
+            // for pipes we read all data until we have the separator
+            if (!map()) while (memmem(_buffer.data(), _buffer.size(), "\n\n", 2) == nullptr && read()) { /* keep reading */ }
+
+            // look for the \n\n separator
+            auto *separator = (const char *)memmem(buffer(), available(), "\n\n", 2);
+
+            // should exist
+            if (separator == nullptr) throw std::runtime_error("missing separator between serialized data and input data");
+
+            // size of the header, including the separator
+            size_t size = separator - buffer() + 2;
 
-        // use stream iterators to copy the stream to a string
-        std::istream_iterator<char> it(std::cin);
-        std::istream_iterator<char> end;
+            // revive the serialized data (only the header is copied), or use
+            // an object that was earlier revived from the same header
+            _data = cache ? cache->revive(buffer(), size) : std::make_shared<Revived>(buffer(), size);
 
-        // create the string
-        _data.reset(new Revived(std::move(std::string(it, end))));
+            // the rest of the data is the payload
+            consume(size);
+        }
+        catch (...)
+        {
+            // skip the rest of the input
+            cleanup();
+
+            // pass on the error
+            throw;
+        }
     }
-    
+
+    /**
+     *  No copying
+     *  @param  that
+     */
+    Stdin(const Stdin &that) = delete;
+
     /**
      *  Destructor
      */
-    virtual ~Stdin() = default;
-    
+    virtual ~Stdin()
+    {
+        // unmap the memory and skip the rest of the input
+        cleanup();
+    }
+
+    /**
+     *  The revived data
+     *  @return std::shared_ptr<Revived>
+     */
+    const std::shared_ptr<Revived> &revived() const
+    {
+        return _data;
+    }
+
     /**
      *  The user-supplied PHP object
      *  @return Php::Value
@@ -61,25 +368,61 @@ public:
     {
         return _data->object();
     }
-    
+
+    /**
+     *  Pass the input data in chunks to a task
+     *  @param  task        Task object that has a process(const char *, size_t) method
+     */
+    template <typename TASK>
+    void process(TASK &task)
+    {
+        // keep going until all data is processed
+        while (true)
+        {
+            // the size of the next chunk
+            size_t size = chunk();
+
+            // if there is no full chunk available, we have to read more data
+            if (size == 0 && read()) continue;
+
+            // leap out if nothing is left
+            if (size == 0) return;
+
+            // pass the chunk to the task
+            task.process(buffer(), size);
+
+            // the data has been processed
+            consume(size);
+        }
+    }
+
     /**
-     *  The input data
+     *  The input data, this reads all remaining input into memory (for input
+     *  that can not be processed in chunks)
      *  @return const char *
      */
-    const char *data() const
+    const char *data()
     {
-        return _data->data();
+        // read all the data
+        while (read()) { /* keep reading */ }
+
+        // expose the buffer
+        return buffer();
     }
-    
+
     /**
      *  Size of the data
      *  @return size_t
      */
-    size_t size() const
+    size_t size()
     {
-        return _data->size();
+        // read all the data
+        while (read()) { /* keep reading */ }
+
+        // expose the size
+        return available();
     }
-    
+
     /**
      *  Target object
      *  @return Yothalot::Target*
@@ -26,6 +26,13 @@ public:
     Target(const std::shared_ptr<Cache> &cache, const char *directory) :
         Yothalot::Target(cache->connection(), directory, cache->maxsize(), cache->ttl()) {}
 
+    /**
+     *  Constructor for a target that only stores data in the cache
+     *  @param  cache           cache settings to use
+     */
+    Target(const std::shared_ptr<Cache> &cache) :
+        Yothalot::Target(cache->connection(), cache->maxsize(), cache->ttl()) {}
+
     /**
      *  Constructor
      *  @param  directory       directory to use
@@ -0,0 +1,161 @@
+/**
+ *  TempFiles.h
+ *
+ *  Worker processes keep local copies of data that they got from the cache
+ *  (stored algorithms and bundled include files) in the temp directory, so
+ *  that the next process on the same machine does not have to fetch them
+ *  again. This class makes sure that these copies do not pile up: only the
+ *  most recently used ones are kept, and copies that were recently used are
+ *  never removed, because another process may be busy with them.
+ *
+ *  @copyright 2016 Copernica BV
+ */
+
+/**
+ *  Include guard
+ */
+#pragma once
+
+/**
+ *  Dependencies
+ */
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <dirent.h>
+#include <ftw.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "tempdir.h"
+
+/**
+ *  Class definition
+ */
+class TempFiles
+{
+private:
+    /**
+     *  Copies that were used less than this number of seconds ago are never removed
+     *  @var time_t
+     */
+    static const time_t minage = 3600;
+
+    /**
+     *  A copy in the temp directory
+     */
+    class Entry
+    {
+    public:
+        /**
+         *  Full path
+         *  @var std::string
+         */
+        std::string path;
+
+        /**
+         *  Last time it was used
+         *  @var time_t
+         */
+        time_t used;
+
+        /**
+         *  Constructor
+         *  @param  path
+         *  @param  used
+         */
+        Entry(std::string path, time_t used) : path(std::move(path)), used(used) {}
+    };
+
+    /**
+     *  Remove a file or directory, including everything in it
+     *  @param  path
+     */
+    static void remove(const std::string &path)
+    {
+        // the callback for each file, the directory contents come first
+        auto callback = [](const char *name, const struct stat *, int, struct FTW *) -> int {
+
+            // remove the file or the (by now empty) directory
+            ::remove(name);
+
+            // go on with the next file
+            return 0;
+        };
+
+        // traverse over the files, depth first and without following symlinks
+        nftw(path.data(), callback, 16, FTW_DEPTH | FTW_PHYS);
+    }
+
+public:
+    /**
+     *  Mark a copy as used, so that it is not removed soon
+     *  @param  path
+     */
+    static void touch(const std::string &path)
+    {
+        // set the modification time to now
+        utimes(path.data(), nullptr);
+    }
+
+    /**
+     *  Remove the least recently used copies with a certain prefix, until
+     *  no more than a maximum number of them is left
+     *  @param  prefix      prefix of the names in the temp directory
+     *  @param  maxcount    max number of copies to keep
+     */
+    static void prune(const char *prefix, size_t maxcount)
+    {
+        // the directory with the copies
+        TempDir directory;
+
+        // open the directory
+        auto *dirp = opendir(directory);
+
+        // leap out on failure
+        if (dirp == nullptr) return;
+
+        // the copies that were found
+        std::vector<Entry> entries;
+
+        // length of the prefix
+        size_t length = strlen(prefix);
+
+        // read all entries
+        while (auto *entry = readdir(dirp))
+        {
+            // only copies with the prefix, and not the temporary files that
+            // are being written right now (their names contain a dot)
+            if (strncmp(entry->d_name, prefix, length) != 0 || strchr(entry->d_name, '.') != nullptr) continue;
+
+            // the full path
+            std::string path = std::string((const char *)directory) + "/" + entry->d_name;
+
+            // find out when it was used
+            struct stat info;
+            if (stat(path.data(), &info) != 0) continue;
+
+            // remember the copy
+            entries.emplace_back(std::move(path), info.st_mtime);
+        }
+
+        // close the directory
+        closedir(dirp);
+
+        // nothing to do if there are not too many copies
+        if (entries.size() <= maxcount) return;
+
+        // sort the copies, the most recently used ones first
+        std::sort(entries.begin(), entries.end(), [](const Entry &a, const Entry &b) { return a.used > b.used; });
+
+        // the current time
+        time_t now = time(nullptr);
+
+        // remove the copies that do not fit, unless they were recently used
+        for (size_t i = maxcount; i < entries.size(); ++i) if (entries[i].used + minage < now) remove(entries[i].path);
+    }
+};
+
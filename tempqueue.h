@@ -1,11 +1,13 @@
 /**
  *  TempQueue.h
  *
- *  Class that creates a temporary queue that can be used for collecting
- *  the results from a Map/Reduce job
+ *  Class that collects the result from a Map/Reduce job via RabbitMQ. The
+ *  results of all jobs that are started via the same connection are
+ *  published to one shared reply queue, this object waits for the result
+ *  with its own correlation ID.
  *
  *  @author Emiel Bruijntjes <emiel.bruijntjes@copernica.com>
- *  @copyright 2015 Copernica BV
+ *  @copyright 2015 - 2016 Copernica BV
  */
 
 /**
@@ -18,11 +20,12 @@
  */
 #include <amqpcpp.h>
 #include "feedback.h"
+#include "replyqueue.h"
 
 /**
  *  Class definition
  */
-class TempQueue : public Feedback
+class TempQueue : public Feedback, private ReplyQueue::Receiver
 {
 private:
     /**
@@ -32,137 +35,59 @@ private:
     std::shared_ptr<Rabbit> _rabbit;
 
     /**
-     *  The event loop
-     *  @var Loop
+     *  The shared reply queue
+     *  @var std::shared_ptr<ReplyQueue>
      */
-    Loop _loop;
-    
-    /**
-     *  AMQP channel that will be used for consuming
-     *  @var AMQP::TcpChannel
-     *
-     *  @todo the connection->channels() > 0 - do we still use that?
-     */
-    AMQP::TcpChannel _channel;
+    std::shared_ptr<ReplyQueue> _replies;
 
-    /**
-     *  Name of the queue
-     *  @var std::string
-     */
-    std::string _name;
 
     /**
-     *  Was the consumer cancelled?
-     *  @var bool
+     *  Called when the reply comes in
+     *  @param  result
      */
-    bool _cancelled = false;
-
-    
-    /**
-     *  Method that is called when the queue has been declared
-     *  @param  name
-     */
-    void onDeclared(const std::string &name)
+    virtual void onReply(const JSON::Object &result) override
     {
-        // store the name
-        _name = name;
-        
-        // start the consumer
-        _channel.consume(_name).onReceived(std::bind(&TempQueue::onReceived, this, _1, _2));
-        
-        // we stop the private event loop, we're going to restart it when the owner starts consuming
-        _loop.stop();
-    }
-    
-    /**
-     *  Method that is called when the message has been consumed
-     *  @param  message
-     *  @param  deliverytag
-     */
-    void onReceived(const AMQP::Message &message, uint64_t deliveryTag)
-    {
-        // ack the message
-        _channel.ack(deliveryTag);
-
-        // stop further consuming
-        _channel.cancel(_name).onSuccess(std::bind(&TempQueue::onCancelled, this, _1));
-
-        // remember that consumer has been cancelled
-        _cancelled = true;
+        // we have the result
+        _ready = true;
 
         // tell the owner
-        _owner->onReceived(this, message.body(), message.bodySize());
+        _owner->onReceived(this, result);
     }
-    
+
     /**
-     *  Channel errors
+     *  Called when the queue failed
      *  @param  message
      */
-    void onError(const char *message)
+    virtual void onFailure(const char *message) override
     {
-        // remember that we're ready, nothing left to clean up
+        // remember that we're ready, nothing left to wait for
         _ready = true;
-        
-        // stop event loop
-        _loop.stop();
-        
+
         // pass to the owner
         _owner->onError(this, message);
     }
-    
-    /**
-     *  Consuming was cancelled
-     *  @param  consumer
-     */
-    void onCancelled(const std::string &consumer)
-    {
-        // we no longer need the queue
-        _channel.removeQueue(_name).onSuccess(std::bind(&TempQueue::onRemoved, this, _1));
-    }
-    
-    /**
-     *  Callback when queue was removed
-     *  @param  messages
-     */
-    void onRemoved(size_t messages)
-    {
-        // close the channel
-        _channel.close().onSuccess(std::bind(&TempQueue::onClosed, this));
-    }
-    
-    /**
-     *  Callback when channel was closed
-     */
-    void onClosed()
-    {
-        // object is ready / result is available
-        _ready = true;
 
-        // stop private event loop
-        _loop.stop();
-    }
-    
 public:
     /**
      *  Constructor
      *  @param  owner       Object that will be notified with the result
      *  @param  rabbit      The core RabbitMQ connection
+     *  @throws std::runtime_error
      */
     TempQueue(Feedback::Owner *owner, const std::shared_ptr<Rabbit> &rabbit) : 
-        Feedback(owner), _rabbit(rabbit), _loop(rabbit->descriptors()), _channel(rabbit->connection())
+        Feedback(owner), _rabbit(rabbit)
     {
-        // set up error handler
-        _channel.onError(std::bind(&TempQueue::onError, this, _1));
-        
-        // flags for creating the queue
-        auto flags = ::AMQP::autodelete | ::AMQP::exclusive;
-
-        // declare the queue
-        _channel.declareQueue(flags).onSuccess(std::bind(&TempQueue::onDeclared, this, _1));
-        
-        // run the event loop, because we need to know the name, this will run
-        // until the declareQueue operation is finished
-        _loop.run(rabbit->connection());
+        // the reply queue that is shared by all jobs of the connection
+        auto &replies = rabbit->replies();
+
+        // the queue is declared by the first job (and again after a failure)
+        if (!replies || !replies->valid()) replies = std::make_shared<ReplyQueue>(rabbit.get());
+
+        // we keep the queue alive too
+        _replies = replies;
+
+        // wait for the reply with our own id
+        _id = _replies->subscribe(this);
     }
 
     /**
@@ -170,24 +95,18 @@ public:
      */
     virtual ~TempQueue()
     {
-        // if we still have things to clean up, we're going to run the event loop a little longer
-        if (_ready) return;
-        
-        // cancel the consumer
-        if (!_cancelled) _channel.cancel(_name).onSuccess(std::bind(&TempQueue::onCancelled, this, _1));
-        
-        // run the event loop a little longer
-        _loop.run(_rabbit->connection());
+        // no longer wait for the reply
+        if (!_ready) _replies->unsubscribe(_id);
     }
 
     /**
-     *  Retrieve the name of the temp queue
+     *  Retrieve the name of the reply queue
      *  @return std::string
      */
     virtual const std::string &name() const override
     {
         // expose member
-        return _name;
+        return _replies->name();
     }
 
     /**
@@ -201,15 +120,16 @@ public:
     }
 
     /**
-     *  Start consuming data from the temporary queue
+     *  Wait for the result to come in
+     *  @param  deadline    moment at which we stop waiting
      */
-    virtual void wait() override
+    virtual void wait(const Deadline &deadline) override
     {
-        // if object is ready, we do not have to do anything
-        if (_ready) return;
-        
-        // start the event loop, it will come to an end when we have the result
-        _loop.run(_rabbit->connection());
+        // construct the event loop
+        Loop loop(_rabbit->descriptors());
+
+        // keep running until the result is there
+        while (!_ready && !deadline.expired() && loop.step(_rabbit->connection(), deadline)) { /* keep going */ }
     }
     
     /**
@@ -0,0 +1,49 @@
+<?php
+/**
+ *  BatchedLineCount.php
+ *
+ *  Variant of the KvLineCount algorithm that receives its input in batches.
+ *  The map(), reduce() and write() methods are inherited, this class only
+ *  adds the optional mapBatch() method.
+ *
+ *  @copyright 2016 Copernica BV
+ *  @documentation private
+ */
+
+/**
+ *  Dependencies
+ */
+require_once('KvLineCount.php');
+
+/**
+ *  Class definition
+ */
+class BatchedLineCount extends KvLineCount
+{
+    /**
+     *  The files that have to be loaded before an object is unserialized,
+     *  the base class is in a file of its own
+     *
+     *  @return string[]    Array of to-be-included files
+     */
+    public function includes()
+    {
+        // we need the base class too
+        return array(__DIR__.'/KvLineCount.php', __FILE__);
+    }
+
+    /**
+     *  Algorithms can implement the optional mapBatch() method to receive
+     *  many key/value pairs in a single call, instead of calling map() for
+     *  each pair. This saves the overhead of a call from the framework into
+     *  PHP for every single pair, which matters when the pairs are small.
+     *
+     *  @param  array       Array of [$key, $value] pairs
+     *  @param  Reducer     Reducer object to which we may emit key/value pairs
+     */
+    public function mapBatch(array $pairs, Yothalot\Reducer $reducer)
+    {
+        // map each pair
+        foreach ($pairs as $pair) $this->map($pair[0], $pair[1], $reducer);
+    }
+}
@@ -0,0 +1,133 @@
+<?php
+/**
+ *  TupleBench.php
+ *
+ *  Algorithm that measures how fast keys and values are converted between
+ *  PHP and Yothalot. The mapper emits tuples with 1, 2 and 8 fields and
+ *  measures the emit rate, the reducer measures how fast the values can
+ *  be iterated. All rates are written to the output file.
+ *
+ *  @copyright 2016 Copernica BV
+ *  @documentation private
+ */
+class TupleBench implements Yothalot\MapReduce2
+{
+    /**
+     *  The output file
+     *  @var string
+     */
+    private $output;
+
+    /**
+     *  The internal file
+     *  @var resource
+     */
+    private $file = null;
+
+    /**
+     *  Constructor
+     *  @param  string      File to which output should be written
+     */
+    public function __construct($output)
+    {
+        // store
+        $this->output = $output;
+    }
+
+    /**
+     *  Files to include
+     *  @return string[]
+     */
+    public function includes()
+    {
+        // we only have to include this file
+        return array(__FILE__);
+    }
+
+    /**
+     *  Construct a tuple with a number of fields
+     *  @param  integer     Number of fields
+     *  @param  integer     Sequence number
+     *  @return mixed
+     */
+    private function tuple($fields, $i)
+    {
+        // a single field is emitted as scalar
+        if ($fields == 1) return $i;
+
+        // half of the fields are numbers, the other half strings
+        $result = array();
+        for ($f = 0; $f < $fields; $f++) $result[] = $f % 2 ? "field-$i" : $i;
+
+        // done
+        return $result;
+    }
+
+    /**
+     *  Emit tuples with different field counts
+     *  @param  mixed       Number of tuples to emit per field count
+     *  @param  mixed       Unused
+     *  @param  Reducer     Reducer object to which we may emit key/value pairs
+     */
+    public function map($key, $value, Yothalot\Reducer $reducer)
+    {
+        // run for all field counts
+        foreach (array(1, 2, 8) as $fields)
+        {
+            // prepare the values up front, so that only the emit is measured
+            $values = array();
+            for ($i = 0; $i < $key; $i++) $values[] = $this->tuple($fields, $i);
+
+            // start the clock
+            $start = microtime(true);
+
+            // emit all values under the same key, so that the reducer can measure iteration
+            foreach ($values as $tuple) $reducer->emit("iterate-$fields", $tuple);
+
+            // report the emit rate
+            $reducer->emit("emit-$fields", (int)($key / max(microtime(true) - $start, 0.000001)));
+        }
+    }
+
+    /**
+     *  Iterate over the values and measure the rate
+     *  @param  mixed       The key
+     *  @param  Values      Traversable object with values linked to the key
+     *  @param  Writer      Object to which the rate is sent
+     */
+    public function reduce($key, Yothalot\Values $values, Yothalot\Writer $writer)
+    {
+        // emit rates are passed on
+        if (strncmp($key, "emit", 4) == 0) { foreach ($values as $value) $writer->emit($value); return; }
+
+        // start the clock
+        $start = microtime(true);
+
+        // iterate over all values
+        $count = 0;
+        foreach ($values as $value) $count++;
+
+        // report the iterate rate
+        $writer->emit((int)($count / max(microtime(true) - $start, 0.000001)));
+    }
+
+    /**
+     *  Write the rates to the output file
+     *  @param  mixed       The key
+     *  @param  mixed       The rate in tuples per second
+     */
+    public function write($key, $value)
+    {
+        if (!$this->file)
+        {
+            // the output file is stored on the gluster
+            $path = new Yothalot\Path($this->output);
+
+            // open the file
+            $this->file = fopen($path->absolute(), "w+");
+        }
+
+        // write to the file
+        fwrite($this->file, "$key: $value tuples/sec\n");
+    }
+}
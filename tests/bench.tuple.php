@@ -0,0 +1,44 @@
+<?php
+/**
+ *  Script to measure the tuple conversion rates
+ *
+ *  @copyright 2016 Copernica BV
+ *  @documentation private
+ */
+
+/**
+ *  Dependencies
+ */
+require_once('TupleBench.php');
+
+/**
+ *  The file to which the rates are written
+ *  @var Yothalot\Path
+ */
+$path = new Yothalot\Path("tuplebench-results.txt");
+
+/**
+ *  Unlink the result upon start, to make sure that we don't display the previous result.
+ */
+@unlink($path->absolute());
+
+/**
+ *  Create the job
+ *  @var Yothalot\Job
+ */
+$job = new Yothalot\Job(new Yothalot\Connection(), new TupleBench($path->relative()));
+
+/**
+ *  A single mapper emits one million tuples per field count
+ */
+$job->add(1000000, "");
+
+/**
+ *  Wait for the result of the job
+ */
+$job->wait();
+
+/**
+ *  Show the rates
+ */
+echo(file_get_contents($path->absolute()));
@@ -0,0 +1,72 @@
+<?php
+/**
+ *  Script to test the mapBatch() method
+ *
+ *  @copyright 2016 Copernica BV
+ *  @documentation private
+ */
+
+/**
+ *  Dependencies
+ */
+require_once('BatchedLineCount.php');
+
+/**
+ *  The output file on the distributed file system
+ *  @var Yothalot\Path
+ */
+$path = new Yothalot\Path("linecount-results-batched.txt");
+
+/**
+ *  Unlink the result upon start, to make sure that we don't display the previous result.
+ */
+unlink($path->absolute());
+
+/**
+ *  Create an instance of the algorithm
+ *  @var BatchedLineCount
+ */
+$linecount = new BatchedLineCount($path->relative());
+
+/**
+ *  Connection to Yothalot
+ *  @var Yothalot\Connection
+ */
+$connection = new Yothalot\Connection();
+
+/**
+ *  Create the job
+ *  @var Yothalot\Job
+ */
+$job = new Yothalot\Job($connection, $linecount);
+
+/**
+ *  Function to list all files and add the pathname
+ *
+ *  @param  job     The job to add it to
+ *  @param  path    The path to search
+ */
+function assign($job, $path)
+{
+    $objects = new RecursiveIteratorIterator(new RecursiveDirectoryIterator($path), RecursiveIteratorIterator::SELF_FIRST);
+    foreach($objects as $name => $object) {
+
+        // add the files with an empty key, they are passed to mapBatch() in batches
+        $job->add("", $object->getPathName());
+    }
+}
+
+/**
+ *  Add every file in the current working directory to the job
+ */
+assign($job, getcwd());
+
+/**
+ *  Wait for the result of the map reduce job
+ */
+$job->wait();
+
+/**
+ *  Show the line counts, they should be the same as the output of test.kvlinecount.php
+ */
+echo(file_get_contents($path->absolute()));
@@ -0,0 +1,32 @@
+<?php
+/**
+ *  Script to test the pool
+ *
+ *  @copyright 2016 Copernica BV
+ *  @documentation private
+ */
+
+/**
+ *  Dependencies
+ */
+require_once('Task.php');
+
+// create the connection
+$master = new Yothalot\Connection();
+
+// create a pool in which no more than four jobs run at the same time
+$pool = new Yothalot\Pool(array("maxrunning" => 4));
+
+// add jobs that are returned by the pool
+for ($i = 0; $i < 10; $i++) $pool->add(new Yothalot\Job($master, new Task("job $i")));
+
+// add a job with a higher priority, that calls a callback when it is ready
+$pool->add(new Yothalot\Job($master, new Task("urgent")), 10, function($job) {
+
+    // show the result
+    var_dump($job->wait()->result());
+});
+
+// show the results in the order in which the jobs complete
+foreach ($pool->completed() as $job) var_dump($job->wait()->result());
+
@@ -17,6 +17,7 @@
  */
 #include <phpcpp.h>
 #include <yothalot.h>
+#include <string>
 #include "json/array.h"
 
 /**
@@ -29,6 +30,26 @@ namespace Tuple {
  */
 class Yothalot : public ::Yothalot::Tuple
 {
+private:
+    /**
+     *  Add a single field
+     *  @param  value
+     */
+    void field(const Php::Value &value)
+    {
+        // check the type only once
+        switch (value.type()) {
+        case Php::Type::Numeric:    add(value.numericValue()); break;
+        case Php::Type::Null:       add(nullptr); break;
+        
+        // strings are copied straight from the buffer of the php string
+        case Php::Type::String:     add(value.rawValue(), value.size()); break;
+        
+        // everything else is converted to a string
+        default:                    add(value.stringValue()); break;
+        }
+    }
+
 public:
     /**
      *  Constructor
@@ -36,21 +57,21 @@ public:
      */
     Yothalot(const Php::Value &value)
     {
+        // check the type only once
+        switch (value.type()) {
+        
         // if we're numeric or a string we just return a tuple with a single value
-        if (value.isNumeric()) add(value.numericValue());
-        if (value.isString())  add(value.stringValue());
+        case Php::Type::Numeric:    add(value.numericValue()); return;
+        case Php::Type::String:     add(value.rawValue(), value.size()); return;
         
         // we only support arrays and objects as the other type
-        if (!value.isArray() && !value.isObject())  return;
+        case Php::Type::Array:
+        case Php::Type::Object:     break;
+        default:                    return;
+        }
         
         // we start looping over it
-        for (auto iter : value)
-        {
-            // we're going to add numeric values as numbers, everything else as strings
-            if (iter.second.isNumeric())   add(iter.second.numericValue());
-            else if (iter.second.isNull()) add(nullptr);
-            else                           add(iter.second.stringValue());
-        }
+        for (auto iter : value) field(iter.second);
     }
     
     /**
@@ -71,8 +92,11 @@ public:
      */
     Php(const Yothalot::Tuple &input)
     {
+        // the number of fields is needed more than once
+        size_t fields = input.fields();
+
         // if we have a single field we're not building an array
-        if (input.fields() == 1)
+        if (fields == 1)
         {
             // we're going to construct a scalar
             if      (input.isNumber(0)) ::Php::Value::operator=(input.number(0));
@@ -84,8 +108,9 @@ public:
             // turn the variable into an array
             setType(::Php::Type::Array);
 
-            // loop over all the fields and add them one by one
-            for (size_t i = 0; i < input.fields(); ++i)
+            // loop over all the fields and add them one by one, because the
+            // indexes are consecutive php keeps this a packed array
+            for (int i = 0; i < (int)fields; ++i)
             {
                 // assign the value
                 if      (input.isNumber(i)) set(i, input.number(i));
@@ -101,6 +126,103 @@ public:
     virtual ~Php() = default;
 };
 
+/**
+ *  Class to make a copy of a yothalot tuple, that stays valid after the
+ *  original tuple is gone
+ */
+class Copy : public ::Yothalot::Tuple
+{
+public:
+    /**
+     *  Constructor for an empty tuple, to which fields can be added
+     */
+    Copy() = default;
+
+    /**
+     *  Constructor
+     *  @param  input
+     */
+    Copy(const ::Yothalot::Tuple &input)
+    {
+        // loop over all the fields and add them one by one
+        for (size_t i = 0; i < input.fields(); ++i)
+        {
+            // determine the type to add
+            if      (input.isNumber(i)) add(input.number(i));
+            else if (input.isNull(i))   add(nullptr);
+            else                        add(input.string(i));
+        }
+    }
+
+    /**
+     *  Destructor
+     */
+    virtual ~Copy() = default;
+
+    /**
+     *  Estimate of the number of bytes in memory used by the copy
+     *  @return size_t
+     */
+    size_t bytes() const
+    {
+        // start with the object itself
+        size_t result = sizeof(Copy);
+
+        // add the fields
+        for (size_t i = 0; i < fields(); ++i) result += isNumber(i) || isNull(i) ? sizeof(int64_t) : string(i).size();
+
+        // done
+        return result;
+    }
+};
+
+/**
+ *  Class to turn a tuple into a string that can be used as an index in a
+ *  (hash) map, two tuples have the same index if they hold the same fields
+ */
+class Index : public std::string
+{
+public:
+    /**
+     *  Constructor
+     *  @param  tuple
+     */
+    Index(const ::Yothalot::Tuple &tuple)
+    {
+        // loop over all the fields
+        for (size_t i = 0; i < tuple.fields(); ++i)
+        {
+            // numbers are stored in binary form
+            if (tuple.isNumber(i))
+            {
+                // get the number
+                int64_t number = tuple.number(i);
+
+                // add type and number
+                append(1, 'n').append((const char *)&number, sizeof(number));
+            }
+
+            // null has no data
+            else if (tuple.isNull(i)) append(1, 'z');
+
+            // strings are prefixed with their size, so that fields can not be confused
+            else
+            {
+                // get the string
+                std::string data = tuple.string(i);
+
+                // add type, size and the data
+                append(1, 's').append(std::to_string(data.size())).append(1, ':').append(data);
+            }
+        }
+    }
+
+    /**
+     *  Destructor
+     */
+    virtual ~Index() = default;
+};
+
 /**
  *  Class to convert a tuple into a json representation
  */
@@ -3,8 +3,12 @@
  *
  *  The values class.
  *
+ *  The values either come from the Yothalot::Values object that is passed
+ *  to a reducer, or from a buffer with values that were emitted by a mapper
+ *  and that are passed to the combine() method.
+ *
  *  @author    Toon Schoenmakers <toon.schoenmakers@copernica.com>
- *  @copyright 2015 Copernica BV
+ *  @copyright 2015 - 2016 Copernica BV
  */
 
 /**
@@ -17,27 +21,239 @@
  */
 #include <phpcpp.h>
 #include <yothalot.h>
+#include <memory>
+#include <vector>
 
+#include "tuple.h"
 #include "valuesiterator.h"
+#include "reduce/base.h"
 
 /**
  *  Class definition
  */
 class Values :
-    public Yothalot::Values,
     public Php::Base,
     public Php::Traversable {
 public:
+    /**
+     *  Type of the buffer with values
+     */
+    using Buffer = std::vector<std::unique_ptr<Tuple::Copy>>;
+
+private:
+    /**
+     *  The values that are passed to the reducer
+     *  @var Yothalot::Values
+     */
+    std::unique_ptr<Yothalot::Values> _values;
+
+    /**
+     *  Buffered values (when the values are passed to a combiner)
+     *  @var Buffer
+     */
+    const Buffer *_buffer = nullptr;
+
+    /**
+     *  Position in the buffer
+     *  @var size_t
+     */
+    size_t _position = 0;
+
+    /**
+     *  The current value as tuple
+     *  @return Yothalot::Tuple
+     */
+    const Yothalot::Tuple &tuple() const
+    {
+        // get it from the source
+        return _values ? **_values : *(*_buffer)[_position];
+    }
+
+    /**
+     *  Find the lowest or highest of the remaining values
+     *  @param  sign        -1 to find the lowest value, 1 to find the highest
+     *  @return Php::Value
+     */
+    Php::Value find(int sign)
+    {
+        // the best value found so far
+        std::unique_ptr<Tuple::Copy> result;
+
+        // consume all values
+        for (; valid(); next())
+        {
+            // skip if the value is not better
+            if (result && Reduce::Base::compare(tuple(), *result) * sign <= 0) continue;
+
+            // remember the value
+            result.reset(new Tuple::Copy(tuple()));
+        }
+
+        // expose the result (null when there were no values)
+        if (!result) return nullptr;
+        return Tuple::Php(*result);
+    }
+
+public:
+    /**
+     *  Constructor
+     *  @param  values      the values passed to the reducer
+     */
+    Values(const Yothalot::Values &values) : _values(new Yothalot::Values(values)) {}
+
     /**
      *  Constructor
+     *  @param  buffer      buffered values
      */
-    Values(const Yothalot::Values &values) : Yothalot::Values(values) {}
+    Values(const Buffer &buffer) : _buffer(&buffer) {}
 
     /**
      *  Destructor
      */
     virtual ~Values() {};
 
+    /**
+     *  Let the object iterate over different values, so that the same PHP
+     *  object can be reused for the next call
+     *  @param  values      the values passed to the reducer
+     */
+    void rebind(const Yothalot::Values &values)
+    {
+        // store the new values
+        _values.reset(new Yothalot::Values(values));
+        _buffer = nullptr;
+        _position = 0;
+    }
+
+    /**
+     *  Let the object iterate over different buffered values
+     *  @param  buffer      buffered values
+     */
+    void rebind(const Buffer &buffer)
+    {
+        // store the new buffer
+        _values.reset();
+        _buffer = &buffer;
+        _position = 0;
+    }
+
+    /**
+     *  Is there a current value?
+     *  @return bool
+     */
+    bool valid() const
+    {
+        // check the source
+        return _values ? (bool)*_values : _position < _buffer->size();
+    }
+
+    /**
+     *  The current value
+     *  @return Php::Value
+     */
+    Php::Value current() const
+    {
+        // construct the tuple
+        return _values ? Tuple::Php(**_values) : Tuple::Php(*(*_buffer)[_position]);
+    }
+
+    /**
+     *  Move on to the next value
+     */
+    void next()
+    {
+        // move on in the source
+        if (_values) ++*_values; else ++_position;
+    }
+
+    /**
+     *  Add up the remaining values, values with multiple fields are added up
+     *  field by field
+     *  @return Php::Value
+     */
+    Php::Value sum()
+    {
+        // the totals per field
+        std::vector<int64_t> totals;
+
+        // consume all values
+        for (; valid(); next())
+        {
+            // the current value
+            const Yothalot::Tuple &value = tuple();
+
+            // make sure we have room for all fields
+            if (totals.size() < value.fields()) totals.resize(value.fields(), 0);
+
+            // add up all fields
+            for (size_t i = 0; i < value.fields(); ++i) totals[i] += Reduce::Base::number(value, i);
+        }
+
+        // a single field is returned as a scalar
+        if (totals.size() <= 1) return totals.empty() ? 0 : totals[0];
+
+        // construct an array with the totals
+        Php::Array result;
+        for (size_t i = 0; i < totals.size(); ++i) result[(int)i] = totals[i];
+
+        // done
+        return result;
+    }
+
+    /**
+     *  Count the remaining values
+     *  @return Php::Value
+     */
+    Php::Value count()
+    {
+        // the number of values
+        int64_t result = 0;
+
+        // consume all values
+        for (; valid(); next()) ++result;
+
+        // done
+        return result;
+    }
+
+    /**
+     *  The lowest of the remaining values
+     *  @return Php::Value
+     */
+    Php::Value min()
+    {
+        return find(-1);
+    }
+
+    /**
+     *  The highest of the remaining values
+     *  @return Php::Value
+     */
+    Php::Value max()
+    {
+        return find(1);
+    }
+
+    /**
+     *  Get the next number of values as array
+     *  @param  params      the max number of values
+     *  @return Php::Value  empty array when there are no more values
+     */
+    Php::Value chunk(Php::Parameters &params)
+    {
+        // the max number of values
+        int64_t size = params[0].numericValue();
+
+        // the result
+        Php::Array result;
+
+        // consume at most the requested number of values
+        for (int i = 0; i < size && valid(); ++i, next()) result[i] = current();
+
+        // done
+        return result;
+    }
+
     /**
      *  Get the iterator
      *  @return Php::Iterator
@@ -46,4 +262,4 @@ public:
     {
         return new ValuesIterator(this);
     }
-};
\ No newline at end of file
+};
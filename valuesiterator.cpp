@@ -5,7 +5,7 @@
  *  of a circular reference (iterator needs the base).
  *
  *  @author Toon Schoenmakers <toon.schoenmakers@copernica.com>
- *  @copyright 2015 Copernica BV
+ *  @copyright 2015 - 2016 Copernica BV
  */
 
 /**
@@ -22,5 +22,40 @@
  */
 ValuesIterator::ValuesIterator(Values *values) :
     Php::Iterator(values),
-    _values(*values)
+    _values(values)
 {}
+
+/**
+ *  Is the iterator on a valid position
+ *  @return bool
+ */
+bool ValuesIterator::valid()
+{
+    // check whether or not we still have a tuple
+    return _values->valid();
+}
+
+/**
+ *  The value at the current position
+ *  @return Php::Value
+ */
+Php::Value ValuesIterator::current()
+{
+    // must be set
+    if (!_values->valid()) return nullptr;
+
+    // construct the tuple
+    return _values->current();
+}
+
+/**
+ *  Move to the next position
+ */
+void ValuesIterator::next()
+{
+    // increment the values
+    _values->next();
+
+    // increment the counter as well
+    ++_counter;
+}
@@ -32,9 +32,9 @@ class ValuesIterator : public Php::Iterator
 private:
     /**
      *  The values belonging to this iterator.
-     *  @var Yothalot::Values
+     *  @var Values
      */
-    Yothalot::Values &_values;
+    Values *_values;
 
     /**
      *  Amount of times the next method has been called
@@ -58,24 +58,13 @@ public:
      *  Is the iterator on a valid position
      *  @return bool
      */
-    virtual bool valid() override
-    {
-        // cast whether or not we still have a tuple
-        return (bool) _values;
-    }
+    virtual bool valid() override;
 
     /**
      *  The value at the current position
      *  @return Php::Value
      */
-    virtual Php::Value current() override
-    {
-        // must be set
-        if (!_values) return nullptr;
-
-        // construct the tuple
-        return Tuple::Php(*_values);
-    }
+    virtual Php::Value current() override;
 
     /**
      *  The key at the current position
@@ -90,14 +79,7 @@ public:
     /**
      *  Move to the next position
      */
-    virtual void next() override
-    {
-        // increment the values
-        ++_values;
-
-        // increment the counter as well
-        ++_counter;
-    }
+    virtual void next() override;
 
     /**
      *  Rewind the iterator to the front position
@@ -18,10 +18,13 @@
  */
 #include <yothalot.h>
 #include <phpcpp.h>
-#include "reducer.h"
-#include "writer.h"
-#include "values.h"
+#include <typeinfo>
+#include "proxies.h"
 #include "record.h"
+#include "reduce/base.h"
+#include "combiner.h"
+#include "aggregator.h"
+#include "datasize.h"
 
 /**
  *  Class definition
@@ -35,6 +38,12 @@ private:
      */
     Php::Object _object;
 
+    /**
+     *  The PHP objects that are passed to the methods of the algorithm
+     *  @var Proxies
+     */
+    Proxies _proxies;
+
     /**
      *  What sort of implementation do we have?
      *  @var enum
@@ -44,6 +53,166 @@ private:
         map_reduce
     } _type = map_reduce;
 
+    /**
+     *  The optional built-in reducer that is returned by the nativeReducer() method
+     *  @var Php::Value
+     */
+    Php::Value _reducer;
+
+    /**
+     *  Pointer to the implementation of the built-in reducer
+     *  @var Reduce::Base
+     */
+    Reduce::Base *_native = nullptr;
+
+    /**
+     *  The optional combiner, when the algorithm has a combine() method
+     *  @var Combiner
+     */
+    std::unique_ptr<Combiner> _combiner;
+
+    /**
+     *  The optional built-in reducer that is returned by the nativeAggregator() method
+     *  @var Php::Value
+     */
+    Php::Value _aggregate;
+
+    /**
+     *  The optional aggregator that merges the mapper output per key
+     *  @var Aggregator
+     */
+    std::unique_ptr<Aggregator> _aggregator;
+
+    /**
+     *  Max number of records or key/value pairs that are passed to mapBatch()
+     *  @var size_t
+     */
+    static const size_t batchsize = 1024;
+
+    /**
+     *  Does the algorithm have a mapBatch() method?
+     *  @var bool
+     */
+    bool _batching = false;
+
+    /**
+     *  Records or key/value pairs that are not yet passed to mapBatch()
+     *  @var Php::Array
+     */
+    Php::Array _batch;
+
+    /**
+     *  Number of items in the batch
+     *  @var size_t
+     */
+    size_t _batched = 0;
+
+    /**
+     *  The reducer for which the batch is collected
+     *  @var Yothalot::Reducer
+     */
+    Yothalot::Reducer *_batchtarget = nullptr;
+
+    /**
+     *  The PHP reducer object that is passed to mapBatch()
+     *  @var Php::Value
+     */
+    Php::Value _batchreducer;
+
+
+    /**
+     *  Get the reducer to which the mapper should emit its key/value pairs
+     *  @param  reducer     the reducer that writes to the shuffle files
+     *  @return Yothalot::Reducer
+     */
+    Yothalot::Reducer &target(Yothalot::Reducer &reducer)
+    {
+        // when combining, the emitted values go to the combiner instead of straight to the shuffle files
+        Yothalot::Reducer &combined = _combiner ? _combiner->target(reducer) : reducer;
+
+        // when aggregating, the values are merged before they are passed on
+        return _aggregator ? _aggregator->target(combined) : combined;
+    }
+
+    /**
+     *  Pass the collected records or key/value pairs to the mapBatch() method
+     */
+    void dispatch()
+    {
+        // nothing to do if the batch is empty
+        if (_batched == 0) return;
+
+        // prevent PHP exceptions from bubbling up
+        try
+        {
+            // forward the entire batch to php at once
+            _object.call("mapBatch", _batch, _batchreducer);
+        }
+        catch (const Php::Exception &exception)
+        {
+            // this is a big problem!
+            Php::error << exception.what() << std::flush;
+        }
+
+        // start a new batch
+        _batch = Php::Array();
+        _batched = 0;
+    }
+
+    /**
+     *  Add a record or key/value pair to the batch
+     *  @param  item        the item to add
+     *  @param  reducer     the reducer that writes to the shuffle files
+     */
+    void batch(const Php::Value &item, Yothalot::Reducer &reducer)
+    {
+        // the batch can only hold items for the same reducer
+        if (&reducer != _batchtarget)
+        {
+            // pass the items for the old reducer
+            dispatch();
+
+            // create one php reducer object that is used for all batches
+            _batchreducer = _proxies.reducer(target(reducer));
+            _batchtarget = &reducer;
+        }
+
+        // add to the batch
+        _batch[(int)_batched++] = item;
+
+        // pass on the batch when it is full
+        if (_batched >= batchsize) dispatch();
+    }
+
+    /**
+     *  Get a built-in reducer that is returned by a method of the algorithm
+     *  @param  method      name of the method
+     *  @param  value       the object is stored in here to keep it alive
+     *  @return Reduce::Base
+     */
+    Reduce::Base *builtin(const char *method, Php::Value &value)
+    {
+        // the method is optional
+        if (!Php::call("method_exists", _object, method).boolValue()) return nullptr;
+
+        // call the method
+        value = _object.call(method);
+
+        // null is allowed, in that case no built-in reducer is used
+        if (value.isNull()) return nullptr;
+
+        // it must be one of the built-in reducers
+        if (value.instanceOf("Yothalot\\Reduce\\Native")) return (Reduce::Base *)value.implementation();
+
+        // this is not fatal, the algorithm simply runs without built-in reducer
+        Php::warning << "The " << method << "() method does not return a Yothalot\\Reduce\\Native object, it is ignored" << std::flush;
+
+        // forget the returned value
+        value = nullptr;
+
+        // no built-in reducer
+        return nullptr;
+    }
 
     /**
      *  Function to map a record
@@ -58,13 +227,16 @@ private:
         // prevent PHP exceptions from bubbling up
         try
         {
-            // turn the record and the reducer into php objects
-            // @todo is it possible to skip turning the record into a shared-ptr?
-            Php::Object phprecord("Yothalot\\Record", new Record(std::make_shared<Yothalot::Record>(record)));
-            Php::Object phpreducer("Yothalot\\Reducer", new Reducer(reducer));
-            
+            // algorithms with a mapBatch() method get the records in batches, these
+            // records outlive this call, so they must be copied
+            if (_batching) return batch(Php::Object("Yothalot\\Record", new Record(std::make_shared<Yothalot::Record>(record))), reducer);
+
+            // turn the record into a php object, without copying it (it is copied
+            // when the call returns or throws, and the object is still referenced)
+            Record::Borrowed borrowed(record);
+
             // forward the map call to php, don't forget to unserialize the data though
-            _object.call("map", phprecord, phpreducer);
+            _object.call("map", borrowed.object(), _proxies.reducer(target(reducer)));
         }
         catch (const Php::Exception &exception)
         {
@@ -85,8 +257,11 @@ private:
         // prevent PHP exceptions from bubbling up
         try
         {
+            // algorithms with a mapBatch() method get the key/value pairs in batches
+            if (_batching) return batch(Php::Array({ Tuple::Php(key), Tuple::Php(value) }), reducer);
+
             // forward the map call to php, don't forget to unserialize the data though
-            _object.call("map", Tuple::Php(key), Tuple::Php(value), Php::Object("Yothalot\\Reducer", new Reducer(reducer)));
+            _object.call("map", Tuple::Php(key), Tuple::Php(value), _proxies.reducer(target(reducer)));
         }
         catch (const Php::Exception &exception)
         {
@@ -103,11 +278,14 @@ private:
      */
     virtual void reduce(const Yothalot::Key &key, const Yothalot::Values &values, Yothalot::Writer &writer) override
     {
+        // built-in reducers do not need php at all
+        if (_native) return _native->reduce(values, writer);
+
         // prevent PHP exceptions from bubbling up
         try
         {
             // forward the reduce call to php, the tuple will only convert the tuple to a Php::Array
-            _object.call("reduce", Tuple::Php(key), Php::Object("Yothalot\\Values", new Values(values)), Php::Object("Yothalot\\Writer", new Writer(writer)));
+            _object.call("reduce", Tuple::Php(key), _proxies.values(values), _proxies.writer(writer));
         }
         catch (const Php::Exception &exception)
         {
@@ -123,11 +301,15 @@ private:
      */
     virtual void write(const Yothalot::Key &key, const Yothalot::Value &value) override
     {
+        // built-in reducers may have to convert the value first
+        Tuple::Copy buffer;
+        const Yothalot::Tuple &result = _native ? _native->finalize(value, buffer) : value;
+
         // prevent PHP exceptions from bubbling up
         try
         {
             // forward the write call to php
-            _object.call("write", Tuple::Php(key), Tuple::Php(value));
+            _object.call("write", Tuple::Php(key), Tuple::Php(result));
         }
         catch (const Php::Exception &exception)
         {
@@ -137,6 +319,43 @@ private:
     }
 
 public:
+    /**
+     *  Helper class that makes sure that nothing that was buffered for a mapper
+     *  task is left behind in the wrapper when the task is over, not even when
+     *  the task failed (the wrapper may be reused for the next task)
+     */
+    class Scope
+    {
+    private:
+        /**
+         *  The wrapper
+         *  @var Wrapper
+         */
+        Wrapper &_wrapper;
+
+    public:
+        /**
+         *  Constructor
+         *  @param  wrapper
+         */
+        Scope(Wrapper &wrapper) : _wrapper(wrapper) {}
+
+        /**
+         *  No copying
+         *  @param  that
+         */
+        Scope(const Scope &that) = delete;
+
+        /**
+         *  Destructor
+         */
+        virtual ~Scope()
+        {
+            // forget everything that was not flushed
+            _wrapper.reset();
+        }
+    };
+
     /**
      *  Constructor
      *  @param  object      The PHP object with the implementation
@@ -149,11 +368,71 @@ public:
         
         // report an error
         else Php::error << "Failed to unserialize to Yothalot\\MapReduce object" << std::flush;
+
+        // the algorithm may want to map records or key/value pairs in batches
+        _batching = Php::call("method_exists", _object, "mapBatch").boolValue();
+
+        // MapReduce2 algorithms may have a combine() method to run on the mapper output
+        if (_object.instanceOf("Yothalot\\MapReduce2") && Php::call("method_exists", _object, "combine").boolValue()) _combiner.reset(new Combiner(_object, _proxies, DataSize(Php::ini_get("yothalot.maxcombine"))));
+
+        // the algorithm may use a built-in reducer (otherwise the regular reduce() method is used)
+        _native = builtin("nativeReducer", _reducer);
+
+        // the algorithm may use a built-in reducer to aggregate the mapper output
+        auto *aggregate = builtin("nativeAggregator", _aggregate);
+
+        // nothing to aggregate
+        if (!aggregate) return;
+
+        // the partial results can only be passed on as they are when they are reduced by the
+        // same built-in reducer (partial counts for example carry a marker that only Count knows)
+        bool finalize = _native == nullptr || typeid(*_native) != typeid(*aggregate);
+
+        // create the aggregator
+        _aggregator.reset(new Aggregator(*aggregate, DataSize(Php::ini_get("yothalot.maxaggregate")), finalize));
     }
 
     /**
      *  Destructor
      */
     virtual ~Wrapper() = default;
+
+    /**
+     *  Pass the items that are still buffered to mapBatch(), the aggregator and
+     *  the combiner, this must be called when the mapper has processed all input
+     */
+    void flush()
+    {
+        // the last batch must still be mapped
+        dispatch();
+
+        // the next task has a different reducer
+        _batchtarget = nullptr;
+
+        // the aggregated values go first, because they may still be combined
+        if (_aggregator) _aggregator->flush();
+
+        // only relevant when combining
+        if (_combiner) _combiner->flush();
+    }
+
+    /**
+     *  Forget the items that are still buffered, and the reducer for which they
+     *  were buffered, without passing them on (the reducer may already be gone)
+     */
+    void reset()
+    {
+        // forget the batch
+        _batch = Php::Array();
+        _batched = 0;
+
+        // forget the reducer
+        _batchtarget = nullptr;
+        _batchreducer = nullptr;
+
+        // forget the aggregated and combined values
+        if (_aggregator) _aggregator->reset();
+        if (_combiner) _combiner->reset();
+    }
 };
 
@@ -26,21 +26,33 @@ class Writer : public Php::Base
 {
 private:
     /**
-     *  The actual underlying writer by reference
+     *  The actual underlying writer
+     *  @var Yothalot::Writer
      */
-    Yothalot::Writer &_writer;
+    Yothalot::Writer *_writer;
 
 public:
     /**
      *  Constructor
      */
-    Writer(Yothalot::Writer &writer) : _writer(writer) {}
+    Writer(Yothalot::Writer &writer) : _writer(&writer) {}
 
     /**
      *  Destructor
      */
     virtual ~Writer() {};
 
+    /**
+     *  Let the object forward to a different writer, so that the same PHP
+     *  object can be reused for the next call
+     *  @param  writer
+     */
+    void rebind(Yothalot::Writer &writer)
+    {
+        // store the new writer
+        _writer = &writer;
+    }
+
     /**
      *  Emit a value
      */
@@ -50,6 +62,6 @@ public:
         Php::Value value = params[0];
 
         // and pass the value as a tuple onto the writer
-        _writer.emit(Tuple::Yothalot(value));
+        _writer->emit(Tuple::Yothalot(value));
     }
 };
\ No newline at end of file